@@ -0,0 +1,294 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "enum.hpp"
+#include "print.hpp"
+#include "program_options.hpp"
+
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/exception.h>
+
+#include <boost/describe/enum.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace profitview
+{
+
+enum class DataKind
+{
+    trades,
+    book
+};
+
+BOOST_DESCRIBE_ENUM(DataKind, trades, book);
+
+enum class Codec
+{
+    none,
+    snappy,
+    gzip,
+    zstd
+};
+
+BOOST_DESCRIBE_ENUM(Codec, none, snappy, gzip, zstd);
+
+struct GeneratorOptions
+{
+    std::string output;
+    DataKind kind = DataKind::trades;
+    double gigabytes = 1.0;
+    std::int64_t rowGroupRows = 1'000'000;
+    Codec codec = Codec::snappy;
+    int levels = 10;
+    std::uint64_t seed = 42;
+    bool reuse = false;
+
+    void addOptions(boost::program_options::options_description& options)
+    {
+        namespace po = boost::program_options;
+        // clang-format off
+        options.add_options()
+            ("output,o", po::value(&output)->required(), "Parquet file to write.")
+            ("kind,k", po::value(&kind)->default_value(kind, "trades"), "Data to generate: trades or book.")
+            ("gigabytes,g", po::value(&gigabytes)->default_value(gigabytes), "Approximate size of the file to write.")
+            ("row-group-rows,r", po::value(&rowGroupRows)->default_value(rowGroupRows), "Rows per Parquet row group.")
+            ("compression,c", po::value(&codec)->default_value(codec, "snappy"), "none, snappy, gzip or zstd.")
+            ("levels,l", po::value(&levels)->default_value(levels), "Price levels per side for book data.")
+            ("seed,s", po::value(&seed)->default_value(seed), "Random seed; equal seeds give identical files.")
+            ("reuse", po::bool_switch(&reuse), "Keep an existing output written with the same options.");
+        // clang-format on
+    }
+};
+
+/// \class MarketSimulator
+///     Random walk on a price grid with exponentially distributed gaps between events and heavy tailed sizes, which
+///     is close enough to real trade and book data to exercise compression and decoding realistically.
+class MarketSimulator
+{
+public:
+    explicit MarketSimulator(std::uint64_t const seed)
+        : mEngine(seed)
+    {}
+
+    std::int64_t nextTime() { return mTime += 1 + static_cast<std::int64_t>(mGap(mEngine)); }
+    std::int64_t nextMid() { return mMid = std::max<std::int64_t>(1, mMid + mMove(mEngine) - 2); }
+    std::int64_t nextSize() { return 1 + static_cast<std::int64_t>(mSize(mEngine)); }
+    bool nextIsBuy() { return mSide(mEngine); }
+    static constexpr double tickSize = 0.5;
+
+private:
+    std::mt19937_64 mEngine;
+    std::exponential_distribution<double> mGap{1.0 / 5'000'000.0};    // 5ms mean, in nanoseconds
+    std::discrete_distribution<int> mMove{1, 8, 82, 8, 1};    // -2..+2 ticks
+    std::lognormal_distribution<double> mSize{3.0, 1.5};
+    std::bernoulli_distribution mSide{0.5};
+    std::int64_t mTime = 1'640'995'200'000'000'000;    // 2022-01-01T00:00:00Z
+    std::int64_t mMid = 80'000;
+};
+
+template<typename Builder>
+std::shared_ptr<arrow::Array> finish(Builder& builder)
+{
+    std::shared_ptr<arrow::Array> result;
+    PARQUET_THROW_NOT_OK(builder.Finish(&result));
+    return result;
+}
+
+std::shared_ptr<arrow::Schema> tradeSchema()
+{
+    return arrow::schema({
+        arrow::field("time", arrow::timestamp(arrow::TimeUnit::NANO), false),
+        arrow::field("price", arrow::float64(), false),
+        arrow::field("size", arrow::int64(), false),
+        arrow::field("side", arrow::utf8(), false)});
+}
+
+std::shared_ptr<arrow::Table> tradeRows(MarketSimulator& market, std::int64_t const rows)
+{
+    arrow::TimestampBuilder time(arrow::timestamp(arrow::TimeUnit::NANO), arrow::default_memory_pool());
+    arrow::DoubleBuilder price;
+    arrow::Int64Builder size;
+    arrow::StringBuilder side;
+    PARQUET_THROW_NOT_OK(time.Reserve(rows));
+    PARQUET_THROW_NOT_OK(price.Reserve(rows));
+    PARQUET_THROW_NOT_OK(size.Reserve(rows));
+    PARQUET_THROW_NOT_OK(side.Reserve(rows));
+
+    for (std::int64_t i = 0; i < rows; ++i)
+    {
+        time.UnsafeAppend(market.nextTime());
+        price.UnsafeAppend(static_cast<double>(market.nextMid()) * MarketSimulator::tickSize);
+        size.UnsafeAppend(market.nextSize());
+        PARQUET_THROW_NOT_OK(side.Append(market.nextIsBuy() ? "buy" : "sell"));
+    }
+    return arrow::Table::Make(tradeSchema(), {finish(time), finish(price), finish(size), finish(side)}, rows);
+}
+
+std::shared_ptr<arrow::Schema> bookSchema(int const levels)
+{
+    arrow::FieldVector fields{arrow::field("time", arrow::timestamp(arrow::TimeUnit::NANO), false)};
+    for (auto const side : {"bid", "ask"})
+        for (int level = 0; level < levels; ++level)
+        {
+            fields.push_back(arrow::field(fmt_ns::format("{}_price_{}", side, level), arrow::float64(), false));
+            fields.push_back(arrow::field(fmt_ns::format("{}_size_{}", side, level), arrow::int64(), false));
+        }
+    return arrow::schema(std::move(fields));
+}
+
+std::shared_ptr<arrow::Table> bookRows(MarketSimulator& market, std::int64_t const rows, int const levels)
+{
+    arrow::TimestampBuilder time(arrow::timestamp(arrow::TimeUnit::NANO), arrow::default_memory_pool());
+    std::vector<arrow::DoubleBuilder> prices(2 * levels);
+    std::vector<arrow::Int64Builder> sizes(2 * levels);
+    PARQUET_THROW_NOT_OK(time.Reserve(rows));
+    for (int i = 0; i < 2 * levels; ++i)
+    {
+        PARQUET_THROW_NOT_OK(prices[i].Reserve(rows));
+        PARQUET_THROW_NOT_OK(sizes[i].Reserve(rows));
+    }
+
+    for (std::int64_t row = 0; row < rows; ++row)
+    {
+        time.UnsafeAppend(market.nextTime());
+        auto const mid = market.nextMid();
+        for (int level = 0; level < levels; ++level)
+        {
+            prices[level].UnsafeAppend(static_cast<double>(mid - 1 - level) * MarketSimulator::tickSize);
+            sizes[level].UnsafeAppend(market.nextSize());
+            prices[levels + level].UnsafeAppend(static_cast<double>(mid + 1 + level) * MarketSimulator::tickSize);
+            sizes[levels + level].UnsafeAppend(market.nextSize());
+        }
+    }
+
+    arrow::ArrayVector columns{finish(time)};
+    for (int i = 0; i < 2 * levels; ++i)
+    {
+        columns.push_back(finish(prices[i]));
+        columns.push_back(finish(sizes[i]));
+    }
+    return arrow::Table::Make(bookSchema(levels), std::move(columns), rows);
+}
+
+parquet::Compression::type compression(Codec const codec)
+{
+    switch (codec)
+    {
+    case Codec::snappy: return parquet::Compression::SNAPPY;
+    case Codec::gzip: return parquet::Compression::GZIP;
+    case Codec::zstd: return parquet::Compression::ZSTD;
+    default: return parquet::Compression::UNCOMPRESSED;
+    }
+}
+
+// Everything that determines the generated file's contents, recorded next to it for --reuse
+std::string parameters(GeneratorOptions const& options)
+{
+    return fmt_ns::format(
+        "kind={} gigabytes={} row-group-rows={} compression={} levels={} seed={}",
+        options.kind,
+        options.gigabytes,
+        options.rowGroupRows,
+        options.codec,
+        options.levels,
+        options.seed);
+}
+
+void generate(GeneratorOptions const& options)
+{
+    if (options.rowGroupRows <= 0 || options.levels <= 0 || options.gigabytes <= 0.0)
+        throw std::invalid_argument("Row group rows, levels and gigabytes must be positive");
+
+    auto const stamp = options.output + ".params";
+    if (options.reuse && std::filesystem::exists(options.output))
+    {
+        std::string previous;
+        std::getline(std::ifstream(stamp), previous);
+        if (previous == parameters(options))
+        {
+            print_ns::print("{}\n", fmt_ns::format("Reusing {} ({})", options.output, previous));
+            return;
+        }
+    }
+
+    auto const target = static_cast<std::int64_t>(options.gigabytes * 1024.0 * 1024.0 * 1024.0);
+    auto const schema = options.kind == DataKind::trades ? tradeSchema() : bookSchema(options.levels);
+
+    if (auto const directory = std::filesystem::path(options.output).parent_path(); !directory.empty())
+        std::filesystem::create_directories(directory);
+    std::filesystem::remove(stamp);    // a partially written file must never look reusable
+
+    std::shared_ptr<arrow::io::FileOutputStream> outfile;
+    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(options.output));
+
+    auto const properties = parquet::WriterProperties::Builder().compression(compression(options.codec))->build();
+    std::unique_ptr<parquet::arrow::FileWriter> writer;
+    PARQUET_THROW_NOT_OK(
+        parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), outfile, properties, &writer));
+
+    MarketSimulator market(options.seed);
+    std::int64_t rows = 0;
+    std::int64_t written = 0;
+    while (written < target)
+    {
+        auto const table = options.kind == DataKind::trades ? tradeRows(market, options.rowGroupRows)
+                                                            : bookRows(market, options.rowGroupRows, options.levels);
+        PARQUET_THROW_NOT_OK(writer->WriteTable(*table, options.rowGroupRows));
+        rows += table->num_rows();
+        PARQUET_ASSIGN_OR_THROW(written, outfile->Tell());
+    }
+    PARQUET_THROW_NOT_OK(writer->Close());
+    PARQUET_THROW_NOT_OK(outfile->Close());
+    std::ofstream(stamp) << parameters(options) << '\n';
+
+    print_ns::print(
+        "{}\n",
+        fmt_ns::format(
+            "Wrote {} {} rows ({} bytes, {} compression) to {}",
+            rows,
+            options.kind,
+            written,
+            options.codec,
+            options.output));
+}
+
+}    // namespace profitview
+
+int main(int argc, char const* argv[])
+{
+    using namespace profitview;
+
+    GeneratorOptions options;
+    HelpDocumentation const help{
+        "generate_market_data", "Writes reproducible synthetic trade or L2 book Parquet files.", Version{0, 0, 1}};
+    if (auto const result = parseProgramOptions(argc, argv, help, options))
+        return *result;
+
+    generate(options);
+    return 0;
+}
@@ -0,0 +1,478 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "format.hpp"
+#include "portfolio_metrics.hpp"
+#include "print.hpp"
+#include "pipeline.hpp"
+#include "program_options.hpp"
+#include "tick_store.hpp"
+
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <arrow/type_traits.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+
+#include <boost/program_options.hpp>
+
+#ifdef _WIN32
+#   ifndef NOMINMAX
+#       define NOMINMAX    // windows.h's min and max macros break std::min and std::max
+#   endif
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   include <windows.h>
+#   include <psapi.h>
+#elif !defined(__linux__)
+#   include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace profitview
+{
+
+struct BenchmarkOptions
+{
+    std::vector<std::string> inputs;
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    int repeats = 1;
+    std::int64_t replayRows = 50'000'000;
+    std::string timeColumn = "time";
+    std::string priceColumn = "price";
+    std::string sizeColumn = "size";
+
+    void addOptions(boost::program_options::options_description& options)
+    {
+        namespace po = boost::program_options;
+        // clang-format off
+        options.add_options()
+            ("input,i", po::value(&inputs)->required()->multitoken(), "Parquet files to read as one dataset.")
+            ("threads,t", po::value(&maxThreads)->default_value(maxThreads), "Largest thread count to measure.")
+            ("repeat,r", po::value(&repeats)->default_value(repeats), "Runs per measurement; the fastest is reported.")
+            ("replay-rows", po::value(&replayRows)->default_value(replayRows), "Ticks held in tick stores for replay.")
+            ("time-column", po::value(&timeColumn)->default_value(timeColumn), "Time column used by extract and replay.")
+            ("price-column", po::value(&priceColumn)->default_value(priceColumn), "Price column used by extract and replay.")
+            ("size-column", po::value(&sizeColumn)->default_value(sizeColumn), "Size column used by extract and replay.");
+        // clang-format on
+    }
+};
+
+/// Restart peak resident set size measurement where the platform allows it; Linux resets VmHWM.
+void resetPeakResident()
+{
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+/// Peak resident set size since resetPeakResident() on Linux, otherwise since the process started, in bytes
+std::int64_t peakResidentBytes()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);)
+        if (line.starts_with("VmHWM:"))
+            return std::stoll(line.substr(6)) * 1024;
+    return 0;
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<std::int64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#   ifdef __APPLE__
+    return usage.ru_maxrss;
+#   else
+    return std::int64_t{usage.ru_maxrss} * 1024;
+#   endif
+#endif
+}
+
+/// \struct Measurement
+///     Fastest wall clock time of a phase and the peak resident memory while it ran.
+struct Measurement
+{
+    double seconds = std::numeric_limits<double>::infinity();
+    std::int64_t peakBytes = 0;
+};
+
+template<std::invocable Run>
+Measurement measure(int const repeats, Run&& run)
+{
+    Measurement result;
+    resetPeakResident();
+    for (int i = 0; i < std::max(1, repeats); ++i)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        run();
+        result.seconds =
+            std::min(result.seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    result.peakBytes = peakResidentBytes();
+    return result;
+}
+
+/// \struct Input
+///     An open Parquet file and its parsed footer.
+struct Input
+{
+    std::shared_ptr<arrow::io::ReadableFile> file;
+    std::shared_ptr<parquet::FileMetaData> footer;
+};
+
+Input openInput(std::string const& fileName)
+{
+    Input input;
+    PARQUET_ASSIGN_OR_THROW(input.file, arrow::io::ReadableFile::Open(fileName));
+    input.footer = parquet::ReadMetaData(input.file);
+    return input;
+}
+
+/// \struct RowGroupTask
+///     One row group of one input, the unit of work the workers of a phase share.
+struct RowGroupTask
+{
+    std::size_t input = 0;
+    int rowGroup = 0;
+};
+
+std::vector<RowGroupTask> rowGroupTasks(std::vector<Input> const& inputs)
+{
+    std::vector<RowGroupTask> tasks;
+    for (std::size_t input = 0; input < inputs.size(); ++input)
+        for (int rowGroup = 0; rowGroup < inputs[input].footer->num_row_groups(); ++rowGroup)
+            tasks.push_back(RowGroupTask{input, rowGroup});
+    return tasks;
+}
+
+// Indices of the tick columns in `input`
+std::vector<int> tickColumns(Input const& input, BenchmarkOptions const& options)
+{
+    std::vector<int> columns;
+    for (auto const& name : {options.timeColumn, options.priceColumn, options.sizeColumn})
+    {
+        auto const column = input.footer->schema()->ColumnIndex(name);
+        if (column < 0)
+            throw std::runtime_error(fmt_ns::format("No column named '{}'", name));
+        columns.push_back(column);
+    }
+    return columns;
+}
+
+// Decode `columns` (all when empty) of one row group on the calling thread, with a reader of its own so that any
+// number of threads can decode row groups of the same file at once
+std::shared_ptr<arrow::Table> readRowGroup(Input const& input, int const rowGroup, std::vector<int> const& columns)
+{
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(parquet::arrow::FileReader::Make(
+        arrow::default_memory_pool(),
+        parquet::ParquetFileReader::Open(input.file, parquet::default_reader_properties(), input.footer),
+        parquet::ArrowReaderProperties{},    // no intra row group threads: workers scale across row groups
+        &reader));
+
+    std::shared_ptr<arrow::Table> table;
+    if (columns.empty())
+    {
+        PARQUET_THROW_NOT_OK(reader->ReadRowGroup(rowGroup, &table));
+    }
+    else
+    {
+        PARQUET_THROW_NOT_OK(reader->ReadRowGroup(rowGroup, columns, &table));
+    }
+    return table;
+}
+
+/// \struct Ticks
+///     The time, price and size columns of a row group copied into contiguous vectors.
+struct Ticks
+{
+    std::vector<std::int64_t> time;
+    std::vector<double> price;
+    std::vector<std::int64_t> size;
+};
+
+// Copy every chunk of the fixed width `column` to its row offset in `out`
+template<typename T>
+void extractColumn(arrow::ChunkedArray const& column, std::vector<T>& out)
+{
+    if (arrow::bit_width(column.type()->id()) != static_cast<int>(8 * sizeof(T)))
+        throw std::runtime_error(fmt_ns::format("Column of type {} cannot be extracted", column.type()->ToString()));
+
+    out.resize(column.length());
+    auto* destination = out.data();
+    for (auto const& chunk : column.chunks())
+    {
+        auto const& data = *chunk->data();
+        std::memcpy(destination, data.GetValues<T>(1), data.length * sizeof(T));
+        destination += data.length;
+    }
+}
+
+// The tick columns of a table read with tickColumns(), in that order
+Ticks extractTicks(arrow::Table const& table)
+{
+    Ticks ticks;
+    extractColumn(*table.column(0), ticks.time);
+    extractColumn(*table.column(1), ticks.price);
+    extractColumn(*table.column(2), ticks.size);
+    return ticks;
+}
+// Run task(0) .. task(count - 1) on exactly `threads` workers, the calling thread being one of them, each taking the
+// next index when it finishes its last.  The first exception stops further tasks and is rethrown once all have joined.
+template<std::invocable<std::size_t> Task>
+void parallelFor(int const threads, std::size_t const count, Task&& task)
+{
+    std::atomic<std::size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto const work = [&]
+    {
+        try
+        {
+            for (auto i = next++; i < count; i = next++)
+                task(i);
+        }
+        catch (...)
+        {
+            next = count;
+            std::lock_guard const lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    {
+        ThreadGroup workers;
+        for (int i = 1; i < threads; ++i)
+            workers.spawn(work);
+        work();
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Compress the first `options.replayRows` ticks into `shards` stores of consecutive ticks
+std::vector<TickStore> buildStores(std::vector<Input> const& inputs, BenchmarkOptions const& options, int const shards)
+{
+    std::int64_t rows = 0;
+    for (auto const& input : inputs)
+        rows += input.footer->num_rows();
+    rows = std::min(rows, options.replayRows);
+
+    std::vector<TickStore> stores(shards);
+    std::int64_t stored = 0;
+    for (auto const& [input, rowGroup] : rowGroupTasks(inputs))
+    {
+        if (stored == rows)
+            break;
+        auto const ticks = extractTicks(*readRowGroup(inputs[input], rowGroup, tickColumns(inputs[input], options)));
+        for (std::size_t i = 0; i < ticks.time.size() && stored < rows; ++i, ++stored)
+            stores[stored * shards / rows].append(Tick{ticks.time[i], ticks.price[i], ticks.size[i]});
+    }
+
+    for (auto& store : stores)
+        store.seal();
+    return stores;
+}
+
+// Replay every store through a PortfolioMetrics that trades one lot every thousand ticks, `threads` stores at once;
+// returns the final equity summed over stores so nothing is optimised out
+double replay(std::vector<TickStore> const& stores, int const threads)
+{
+    std::vector<double> equity(stores.size());
+    parallelFor(
+        threads,
+        stores.size(),
+        [&](std::size_t const shard)
+        {
+            PortfolioMetrics metrics(MetricsOptions{.period = 60'000'000'000});    // minute equity samples
+            std::size_t count = 0;
+            stores[shard].replay(
+                [&](Tick const& tick)
+                {
+                    if (++count % 1000 == 0)
+                        metrics.onFill(Fill{tick.time, 0, count % 2000 == 0 ? -1.0 : 1.0, tick.price});
+                    else
+                        metrics.onMark(tick.time, 0, tick.price);
+                });
+            equity[shard] = metrics.equity();
+        });
+
+    double total = 0.0;
+    for (auto const value : equity)
+        total += value;
+    return total;
+}
+
+std::vector<int> threadCounts(int const maxThreads)
+{
+    std::vector<int> result;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        result.push_back(threads);
+    result.push_back(std::max(1, maxThreads));
+    return result;
+}
+
+void report(
+    std::string_view const phase,
+    int const threads,
+    Measurement const& measurement,
+    std::int64_t const rows,
+    std::int64_t const bytes)
+{
+    constexpr double megabyte = 1024.0 * 1024.0;
+    print_ns::print(
+        "{:<8} {:>7} {:>10.3f} {:>14.0f} {:>10.1f} {:>12.1f}\n",
+        phase,
+        threads,
+        measurement.seconds,
+        static_cast<double>(rows) / measurement.seconds,
+        static_cast<double>(bytes) / megabyte / measurement.seconds,
+        static_cast<double>(measurement.peakBytes) / megabyte);
+}
+
+// Each phase runs on exactly `threads` workers which share the row groups (or tick stores) between them, decoding
+// each one on a single thread, so at most `threads` row groups are in memory at once whatever the dataset size; only
+// the replay sample of `options.replayRows` ticks is held, compressed, throughout.  Opening parses the footers once,
+// serially, before the sweep.
+void benchmark(BenchmarkOptions const& options)
+{
+    std::int64_t fileBytes = 0;
+    for (auto const& input : options.inputs)
+        fileBytes += static_cast<std::int64_t>(std::filesystem::file_size(input));
+
+    // Open: footer parsing only, which is single threaded
+    std::vector<Input> inputs;
+    auto const open = measure(
+        options.repeats,
+        [&]
+        {
+            inputs.clear();
+            for (auto const& fileName : options.inputs)
+                inputs.push_back(openInput(fileName));
+        });
+    std::int64_t rows = 0;
+    for (auto const& input : inputs)
+        rows += input.footer->num_rows();
+    auto const tasks = rowGroupTasks(inputs);
+
+    print_ns::print("{} files, {} bytes, {} row groups\n", options.inputs.size(), fileBytes, tasks.size());
+    if (tasks.size() < static_cast<std::size_t>(options.maxThreads))
+        print_ns::print("Decode and extract cannot use more threads than there are row groups\n");
+    print_ns::print(
+        "{:<8} {:>7} {:>10} {:>14} {:>10} {:>12}\n", "phase", "threads", "seconds", "rows/s", "MB/s", "peak RSS MB");
+    report("open", 1, open, rows, fileBytes);
+
+    std::vector<std::vector<int>> columns;
+    for (auto const& input : inputs)
+        columns.push_back(tickColumns(input, options));
+
+    auto const tickBytes = rows * static_cast<std::int64_t>(sizeof(Tick));
+    auto const stores = buildStores(inputs, options, std::max(1, options.maxThreads));
+    std::int64_t replayRows = 0;
+    for (auto const& store : stores)
+        replayRows += static_cast<std::int64_t>(store.size());
+
+    for (auto const threads : threadCounts(options.maxThreads))
+    {
+        // Decode: decompress and decode every column of each row group into Arrow arrays, then drop them.  Counting
+        // the rows checks every row group was read and keeps the work observable.
+        std::atomic<std::int64_t> decoded = 0;
+        auto const decode = measure(
+            options.repeats,
+            [&]
+            {
+                decoded = 0;
+                parallelFor(
+                    threads,
+                    tasks.size(),
+                    [&](std::size_t const i)
+                    { decoded += readRowGroup(inputs[tasks[i].input], tasks[i].rowGroup, {})->num_rows(); });
+            });
+        if (decoded != rows)
+            throw std::runtime_error("Decode read a different number of rows than the footers hold");
+        report("decode", threads, decode, rows, fileBytes);
+
+        // Extract: decode the tick columns and copy them out of Arrow's chunks into contiguous memory
+        std::atomic<std::int64_t> extracted = 0;
+        auto const extract = measure(
+            options.repeats,
+            [&]
+            {
+                extracted = 0;
+                parallelFor(
+                    threads,
+                    tasks.size(),
+                    [&](std::size_t const i)
+                    {
+                        auto const& [input, rowGroup] = tasks[i];
+                        auto const ticks = extractTicks(*readRowGroup(inputs[input], rowGroup, columns[input]));
+                        extracted += static_cast<std::int64_t>(ticks.time.size());
+                    });
+            });
+        if (extracted != rows)
+            throw std::runtime_error("Extract copied a different number of rows than the footers hold");
+        report("extract", threads, extract, rows, tickBytes);
+
+        // Replay: decode the compressed stores and run a strategy over them, one store per task
+        double equity = 0.0;
+        auto const replayed = measure(options.repeats, [&] { equity = replay(stores, threads); });
+        report("replay", threads, replayed, replayRows, replayRows * static_cast<std::int64_t>(sizeof(Tick)));
+        if (!std::isfinite(equity))
+            throw std::runtime_error("Replay produced a non-finite equity");
+    }
+}
+
+}    // namespace profitview
+
+int main(int argc, char const* argv[])
+{
+    using namespace profitview;
+
+    BenchmarkOptions options;
+    HelpDocumentation const help{
+        "scaling_benchmark",
+        "Measures throughput, peak memory and thread scaling of opening, decoding, extracting and replaying Parquet "
+        "market data.",
+        Version{0, 0, 1}};
+    if (auto const result = parseProgramOptions(argc, argv, help, options))
+        return *result;
+
+    benchmark(options);
+    return 0;
+}
@@ -0,0 +1,437 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include "format.hpp"
+#include "ranges.hpp"
+
+#include <arrow/api.h>
+#include <arrow/compute/api.h>
+#include <arrow/compute/exec.h>
+#include <arrow/compute/exec/expression.h>
+#include <arrow/util/parallel.h>
+#include <parquet/exception.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace profitview
+{
+
+/// \struct LagReference
+///     A column shifted down by `periods` rows, referenced in an expression as the field `name`.
+struct LagReference
+{
+    std::string column;
+    std::int64_t periods = 1;
+    std::string name;
+};
+
+/// \struct ParsedExpression
+///     An Arrow compute expression together with the lagged columns it needs.
+struct ParsedExpression
+{
+    arrow::compute::Expression expression;
+    std::vector<LagReference> lags;
+};
+
+/// \class ExpressionParser
+///     Recursive descent parser for column expressions such as `price * size`, `(bid + ask) / 2` or
+///     `price / lag(price) - 1`.  From lowest to highest precedence the grammar supports `or`, `and`, `not`,
+///     comparisons (`< <= > >= == !=`), `+ -`, `* /`, unary `-` and right associative `^`.  Any other call
+///     `name(args...)` is passed through to the Arrow compute function of that name (e.g. `abs`, `sqrt`, `ln`), except
+///     `lag(column[, periods])` which refers to a shifted copy of a column.  Integer division truncates as in Arrow.
+class ExpressionParser
+{
+public:
+    explicit ExpressionParser(std::string_view const text)
+        : mText(text)
+    {}
+
+    ParsedExpression parse()
+    {
+        auto expression = orExpression();
+        skipSpace();
+        if (mPosition != mText.size())
+            fail("Unexpected input");
+        return ParsedExpression{std::move(expression), std::move(mLags)};
+    }
+
+private:
+    using Expression = arrow::compute::Expression;
+
+    Expression orExpression()
+    {
+        auto result = andExpression();
+        while (consumeKeyword("or"))
+            result = arrow::compute::call("or_kleene", {std::move(result), andExpression()});
+        return result;
+    }
+
+    Expression andExpression()
+    {
+        auto result = notExpression();
+        while (consumeKeyword("and"))
+            result = arrow::compute::call("and_kleene", {std::move(result), notExpression()});
+        return result;
+    }
+
+    Expression notExpression()
+    {
+        if (consumeKeyword("not"))
+            return arrow::compute::call("invert", {notExpression()});
+        return comparison();
+    }
+
+    Expression comparison()
+    {
+        static constexpr std::pair<std::string_view, char const*> operators[] = {
+            {"<=", "less_equal"},
+            {">=", "greater_equal"},
+            {"==", "equal"},
+            {"!=", "not_equal"},
+            {"<", "less"},
+            {">", "greater"}};
+
+        auto result = additive();
+        for (auto const& [symbol, function] : operators)
+            if (consume(symbol))
+                return arrow::compute::call(function, {std::move(result), additive()});
+        return result;
+    }
+
+    Expression additive()
+    {
+        auto result = multiplicative();
+        for (;;)
+        {
+            if (consume("+"))
+                result = arrow::compute::call("add", {std::move(result), multiplicative()});
+            else if (consume("-"))
+                result = arrow::compute::call("subtract", {std::move(result), multiplicative()});
+            else
+                return result;
+        }
+    }
+
+    Expression multiplicative()
+    {
+        auto result = unary();
+        for (;;)
+        {
+            if (consume("*"))
+                result = arrow::compute::call("multiply", {std::move(result), unary()});
+            else if (consume("/"))
+                result = arrow::compute::call("divide", {std::move(result), unary()});
+            else
+                return result;
+        }
+    }
+
+    Expression unary()
+    {
+        if (consume("-"))
+            return arrow::compute::call("negate", {unary()});
+        return power();
+    }
+
+    Expression power()
+    {
+        auto base = primary();
+        if (consume("^"))
+            return arrow::compute::call("power", {std::move(base), unary()});
+        return base;
+    }
+
+    Expression primary()
+    {
+        skipSpace();
+        if (consume("("))
+        {
+            auto result = orExpression();
+            expect(")");
+            return result;
+        }
+        if (mPosition < mText.size() && (std::isdigit(static_cast<unsigned char>(mText[mPosition])) || mText[mPosition] == '.'))
+            return number();
+
+        auto const name = identifier();
+        if (!consume("("))
+            return arrow::compute::field_ref(std::string{name});
+        if (name == "lag")
+            return lag();
+
+        std::vector<Expression> arguments;
+        if (!consume(")"))
+        {
+            do
+                arguments.push_back(orExpression());
+            while (consume(","));
+            expect(")");
+        }
+        return arrow::compute::call(std::string{name}, std::move(arguments));
+    }
+
+    Expression lag()
+    {
+        LagReference reference{std::string{identifier()}};
+        if (consume(","))
+        {
+            skipSpace();
+            auto const start = mText.data() + mPosition;
+            auto const [end, error] = std::from_chars(start, mText.data() + mText.size(), reference.periods);
+            if (error != std::errc{} || reference.periods < 1)
+                fail("Expected a positive number of periods");
+            mPosition += static_cast<std::size_t>(end - start);
+        }
+        expect(")");
+
+        reference.name = fmt_ns::format("lag({},{})", reference.column, reference.periods);
+        if (ranges::none_of(mLags, [&reference](auto const& lag) { return lag.name == reference.name; }))
+            mLags.push_back(reference);
+        return arrow::compute::field_ref(reference.name);
+    }
+
+    Expression number()
+    {
+        auto const start = mText.data() + mPosition;
+        auto const last = mText.data() + mText.size();
+        auto end = start;
+        while (end != last && (std::isalnum(static_cast<unsigned char>(*end)) || *end == '.' ||
+                               ((*end == '+' || *end == '-') && (end[-1] == 'e' || end[-1] == 'E'))))
+            ++end;
+
+        std::string_view const token(start, static_cast<std::size_t>(end - start));
+        mPosition += token.size();
+        if (token.find_first_of(".eE") == std::string_view::npos)
+        {
+            std::int64_t value = 0;
+            if (std::from_chars(start, end, value).ptr == end)
+                return arrow::compute::literal(value);
+        }
+        else if (token.find_first_of("xX") == std::string_view::npos)
+        {
+            // Floating point from_chars is missing from older libc++, so strtod parses a null terminated copy
+            std::string const text(token);
+            char* parsed = nullptr;
+            errno = 0;
+            auto const value = std::strtod(text.c_str(), &parsed);
+            if (parsed == text.c_str() + text.size() && errno != ERANGE)
+                return arrow::compute::literal(value);
+        }
+        fail("Invalid number");
+    }
+
+    std::string_view identifier()
+    {
+        skipSpace();
+        auto const start = mPosition;
+        while (mPosition < mText.size() &&
+               (std::isalnum(static_cast<unsigned char>(mText[mPosition])) || mText[mPosition] == '_'))
+            ++mPosition;
+        if (start == mPosition || std::isdigit(static_cast<unsigned char>(mText[start])))
+            fail("Expected a column or function name");
+        return mText.substr(start, mPosition - start);
+    }
+
+    void skipSpace()
+    {
+        while (mPosition < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPosition])))
+            ++mPosition;
+    }
+
+    bool consume(std::string_view const token)
+    {
+        skipSpace();
+        if (!mText.substr(mPosition).starts_with(token))
+            return false;
+        mPosition += token.size();
+        return true;
+    }
+
+    bool consumeKeyword(std::string_view const keyword)
+    {
+        skipSpace();
+        auto const end = mPosition + keyword.size();
+        if (!mText.substr(mPosition).starts_with(keyword) ||
+            (end < mText.size() && (std::isalnum(static_cast<unsigned char>(mText[end])) || mText[end] == '_')))
+            return false;
+        mPosition = end;
+        return true;
+    }
+
+    void expect(std::string_view const token)
+    {
+        if (!consume(token))
+            fail(fmt_ns::format("Expected '{}'", token));
+    }
+
+    [[noreturn]] void fail(std::string_view const message) const
+    {
+        throw std::invalid_argument(fmt_ns::format("{} at position {} of expression '{}'", message, mPosition, mText));
+    }
+
+    std::string_view mText;
+    std::size_t mPosition = 0;
+    std::vector<LagReference> mLags;
+};
+
+inline ParsedExpression parseExpression(std::string_view const text)
+{
+    return ExpressionParser(text).parse();
+}
+
+namespace expression_detail
+{
+
+// Append the lagged columns an expression refers to; slicing keeps this zero-copy apart from the leading nulls
+inline std::shared_ptr<arrow::Table> withLags(std::shared_ptr<arrow::Table> table, std::vector<LagReference> const& lags)
+{
+    auto const rows = table->num_rows();
+    for (auto const& lag : lags)
+    {
+        auto const column = table->GetColumnByName(lag.column);
+        if (!column)
+            throw std::invalid_argument(fmt_ns::format("Unknown column '{}' in lag", lag.column));
+
+        auto const periods = std::min(lag.periods, rows);
+        std::shared_ptr<arrow::Array> nulls;
+        PARQUET_ASSIGN_OR_THROW(nulls, arrow::MakeArrayOfNull(column->type(), periods));
+        arrow::ArrayVector chunks{nulls};
+        for (auto const& chunk : column->Slice(0, rows - periods)->chunks())
+            chunks.push_back(chunk);
+
+        std::shared_ptr<arrow::ChunkedArray> shifted;
+        PARQUET_ASSIGN_OR_THROW(shifted, arrow::ChunkedArray::Make(std::move(chunks), column->type()));
+        PARQUET_ASSIGN_OR_THROW(
+            table, table->AddColumn(table->num_columns(), arrow::field(lag.name, column->type()), shifted));
+    }
+    return table;
+}
+
+inline std::vector<std::shared_ptr<arrow::RecordBatch>> recordBatches(arrow::Table const& table)
+{
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    arrow::TableBatchReader reader(table);
+    for (std::shared_ptr<arrow::RecordBatch> batch;;)
+    {
+        PARQUET_THROW_NOT_OK(reader.ReadNext(&batch));
+        if (!batch)
+            break;
+        batches.push_back(std::move(batch));
+    }
+    // An empty batch still lets the expression determine its output type
+    if (batches.empty())
+    {
+        std::shared_ptr<arrow::RecordBatch> empty;
+        PARQUET_ASSIGN_OR_THROW(empty, arrow::RecordBatch::MakeEmpty(table.schema()));
+        batches.push_back(std::move(empty));
+    }
+    return batches;
+}
+
+// Evaluate the bound expression over every batch of `table` in parallel on Arrow's CPU thread pool
+inline std::vector<std::shared_ptr<arrow::Array>> evaluateBatches(
+    std::vector<std::shared_ptr<arrow::RecordBatch>> const& batches, arrow::compute::Expression const& expression)
+{
+    std::vector<std::shared_ptr<arrow::Array>> results(batches.size());
+    PARQUET_THROW_NOT_OK(arrow::internal::ParallelFor(
+        static_cast<int>(batches.size()),
+        [&](int const i) -> arrow::Status
+        {
+            auto const& batch = *batches[i];
+            ARROW_ASSIGN_OR_RAISE(
+                auto value, arrow::compute::ExecuteScalarExpression(expression, arrow::compute::ExecBatch(batch)));
+            if (value.is_scalar())
+            {
+                ARROW_ASSIGN_OR_RAISE(results[i], arrow::MakeArrayFromScalar(*value.scalar(), batch.num_rows()));
+            }
+            else
+            {
+                results[i] = value.make_array();
+            }
+            return arrow::Status::OK();
+        }));
+    return results;
+}
+
+inline std::vector<std::shared_ptr<arrow::RecordBatch>> bindAndSplit(
+    std::shared_ptr<arrow::Table> const& table, ParsedExpression const& parsed, arrow::compute::Expression& bound)
+{
+    auto const input = withLags(table, parsed.lags);
+    PARQUET_ASSIGN_OR_THROW(bound, parsed.expression.Bind(*input->schema()));
+    return recordBatches(*input);
+}
+
+}    // namespace expression_detail
+
+/// Evaluate `parsed` over `table` in one pass per chunk, in parallel across chunks.  The result is chunked like the
+/// table; nothing is copied into intermediate tables.
+inline std::shared_ptr<arrow::ChunkedArray> evaluateExpression(
+    std::shared_ptr<arrow::Table> const& table, ParsedExpression const& parsed)
+{
+    using namespace expression_detail;
+
+    arrow::compute::Expression bound;
+    auto const batches = bindAndSplit(table, parsed, bound);
+
+    std::shared_ptr<arrow::ChunkedArray> result;
+    PARQUET_ASSIGN_OR_THROW(result, arrow::ChunkedArray::Make(evaluateBatches(batches, bound)));
+    return result;
+}
+
+/// Rows of `table` for which the boolean expression `parsed` is true; null counts as false.
+inline std::shared_ptr<arrow::Table> filterTable(std::shared_ptr<arrow::Table> const& table, ParsedExpression const& parsed)
+{
+    using namespace expression_detail;
+
+    arrow::compute::Expression bound;
+    auto const batches = bindAndSplit(table, parsed, bound);
+    auto const masks = evaluateBatches(batches, bound);
+    if (masks.front()->type_id() != arrow::Type::BOOL)
+        throw std::invalid_argument("Filter expression must be boolean, not " + masks.front()->type()->ToString());
+
+    std::vector<std::shared_ptr<arrow::RecordBatch>> filtered(batches.size());
+    PARQUET_THROW_NOT_OK(arrow::internal::ParallelFor(
+        static_cast<int>(batches.size()),
+        [&](int const i) -> arrow::Status
+        {
+            // Drop any lag columns before filtering
+            auto const& batch = *batches[i];
+            auto const all = batch.columns();
+            arrow::ArrayVector columns(all.begin(), all.begin() + table->num_columns());
+            auto const original = arrow::RecordBatch::Make(table->schema(), batch.num_rows(), std::move(columns));
+            ARROW_ASSIGN_OR_RAISE(auto rows, arrow::compute::Filter(original, masks[i]));
+            filtered[i] = rows.record_batch();
+            return arrow::Status::OK();
+        }));
+
+    std::shared_ptr<arrow::Table> result;
+    PARQUET_ASSIGN_OR_THROW(result, arrow::Table::FromRecordBatches(table->schema(), filtered));
+    return result;
+}
+
+}    // namespace profitview
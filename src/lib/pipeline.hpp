@@ -0,0 +1,244 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace profitview
+{
+
+/// \class SpscQueue
+///     Bounded lock-free queue between exactly one producer and one consumer thread.  A full queue blocks `push` and
+///     an empty one blocks `pop`, waiting on the index atomics themselves.  Either side may `close` the queue: the
+///     consumer still drains what was pushed, while further pushes fail so a cancelled consumer releases its producer.
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(std::size_t const capacity)
+        : mSlots(capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("Queue capacity must be positive");
+    }
+
+    SpscQueue(SpscQueue const&) = delete;
+    SpscQueue& operator=(SpscQueue const&) = delete;
+
+    std::size_t capacity() const { return mSlots.size(); }
+
+    /// Blocks while the queue is full; false, dropping `value`, once the queue is closed.
+    bool push(T value)
+    {
+        auto const tail = mTail.load(std::memory_order_relaxed) & ~closedBit;
+        for (;;)
+        {
+            auto const head = mHead.load(std::memory_order_acquire);
+            if (head & closedBit)
+                return false;
+            if (tail - head < capacity())
+                break;
+            mHead.wait(head, std::memory_order_acquire);
+        }
+        mSlots[tail % capacity()].emplace(std::move(value));
+        mTail.fetch_add(1, std::memory_order_release);
+        mTail.notify_one();
+        return true;
+    }
+
+    /// Blocks while the queue is empty; nullopt once it is closed and drained.
+    std::optional<T> pop()
+    {
+        auto const head = mHead.load(std::memory_order_relaxed) & ~closedBit;
+        for (;;)
+        {
+            auto const tail = mTail.load(std::memory_order_acquire);
+            if ((tail & ~closedBit) != head)
+                break;
+            if (tail & closedBit)
+                return std::nullopt;
+            mTail.wait(tail, std::memory_order_acquire);
+        }
+        auto& slot = mSlots[head % capacity()];
+        std::optional<T> result{std::move(slot)};
+        slot.reset();
+        mHead.fetch_add(1, std::memory_order_release);
+        mHead.notify_one();
+        return result;
+    }
+
+    void close()
+    {
+        // The flag lives in the indices so that closing wakes a side waiting on either of them
+        mTail.fetch_or(closedBit, std::memory_order_acq_rel);
+        mTail.notify_all();
+        mHead.fetch_or(closedBit, std::memory_order_acq_rel);
+        mHead.notify_all();
+    }
+
+private:
+    static constexpr std::size_t closedBit = std::size_t{1} << (std::numeric_limits<std::size_t>::digits - 1);
+
+    std::vector<std::optional<T>> mSlots;
+    alignas(64) std::atomic<std::size_t> mHead{0};    ///< Next slot to pop, advanced by the consumer only
+    alignas(64) std::atomic<std::size_t> mTail{0};    ///< Next slot to push, advanced by the producer only
+};
+
+/// \class ThreadGroup
+///     Threads which are all joined when the group is destroyed, however its scope is left.  Stands in for
+///     std::jthread, which older libc++ lacks; the functions run are expected to finish on their own.
+class ThreadGroup
+{
+public:
+    ThreadGroup() = default;
+    ThreadGroup(ThreadGroup const&) = delete;
+    ThreadGroup& operator=(ThreadGroup const&) = delete;
+    ~ThreadGroup() { join(); }
+
+    template<std::invocable Function>
+    void spawn(Function&& function)
+    {
+        mThreads.emplace_back(std::forward<Function>(function));
+    }
+
+    void join()
+    {
+        for (auto& thread : mThreads)
+            if (thread.joinable())
+                thread.join();
+    }
+
+private:
+    std::vector<std::thread> mThreads;
+};
+
+/// \struct PipelineOptions
+///     Configuration of runPipeline.
+struct PipelineOptions
+{
+    std::size_t depth = 2;    ///< Batches each queue between stages holds; 2 double buffers every stage
+};
+
+namespace pipeline_detail
+{
+
+// Run `stage` over everything popped from `in`, pushing the results to `out`.  However it ends, both queues are
+// closed so that a failure or an early exit anywhere unblocks every other stage.
+template<typename In, typename Out, typename Stage>
+void relay(SpscQueue<In>& in, SpscQueue<Out>& out, Stage& stage, std::exception_ptr& error)
+{
+    try
+    {
+        while (auto item = in.pop())
+            if (!out.push(std::invoke(stage, std::move(*item))))
+                break;
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    in.close();
+    out.close();
+}
+
+}    // namespace pipeline_detail
+
+/// Run read → decode → transform → consume as a pipeline, each of the first three stages on its own thread and
+/// `consume` on the calling thread, so that reading batch n+2 and decoding batch n+1 overlap consuming batch n.
+///
+/// `read` returns successive batches and nullopt at the end; `decode` and `transform` map one batch to the next
+/// stage's; `consume` receives the batches in order.  Queues of `options.depth` batches join the stages, so at most
+/// 3 * depth + 4 batches exist at once whatever the relative speed of the stages.  The first exception thrown by any
+/// stage stops the pipeline and is rethrown here once every thread has finished.
+template<
+    std::invocable Read,
+    typename Batch = typename std::invoke_result_t<Read>::value_type,
+    std::invocable<Batch> Decode,
+    typename Decoded = std::invoke_result_t<Decode, Batch>,
+    std::invocable<Decoded> Transform,
+    typename Transformed = std::invoke_result_t<Transform, Decoded>,
+    std::invocable<Transformed> Consume>
+void runPipeline(Read read, Decode decode, Transform transform, Consume consume, PipelineOptions const& options = {})
+{
+    using namespace pipeline_detail;
+
+    SpscQueue<Batch> batches(options.depth);
+    SpscQueue<Decoded> decoded(options.depth);
+    SpscQueue<Transformed> transformed(options.depth);
+    std::array<std::exception_ptr, 4> errors;
+
+    {
+        ThreadGroup stages;
+        try
+        {
+            stages.spawn(
+                [&]
+                {
+                    try
+                    {
+                        while (auto batch = std::invoke(read))
+                            if (!batches.push(std::move(*batch)))
+                                break;
+                    }
+                    catch (...)
+                    {
+                        errors[0] = std::current_exception();
+                    }
+                    batches.close();
+                });
+            stages.spawn([&] { relay(batches, decoded, decode, errors[1]); });
+            stages.spawn([&] { relay(decoded, transformed, transform, errors[2]); });
+        }
+        catch (...)
+        {
+            // Release the stages already started so that joining them cannot block
+            batches.close();
+            decoded.close();
+            transformed.close();
+            throw;
+        }
+
+        try
+        {
+            while (auto batch = transformed.pop())
+                std::invoke(consume, std::move(*batch));
+        }
+        catch (...)
+        {
+            errors[3] = std::current_exception();
+        }
+        transformed.close();
+    }
+
+    for (auto const& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+}
+
+}    // namespace profitview
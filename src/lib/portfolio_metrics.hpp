@@ -0,0 +1,308 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace profitview
+{
+
+/// \struct Fill
+///     An execution; `quantity` is signed, positive for buys.  A fill with zero quantity is a mark.
+struct Fill
+{
+    std::int64_t time = 0;
+    std::size_t instrument = 0;
+    double quantity = 0.0;
+    double price = 0.0;
+    double fee = 0.0;
+};
+
+/// \struct MetricsOptions
+///     Configuration of a PortfolioMetrics run.
+struct MetricsOptions
+{
+    double initialCapital = 0.0;    ///< Starting equity, also the denominator of returns and turnover when positive
+    std::int64_t period = 0;        ///< Equity is sampled once per period of the time index; 0 samples every event
+    double periodsPerYear = 252.0;  ///< Annualisation factor for Sharpe and Sortino ratios, which need a period
+};
+
+/// \struct PortfolioReport
+///     Results of a PortfolioMetrics run.  Curves hold one entry per sampling period; instrument vectors hold one entry
+///     per instrument in order of first appearance, whose ids are in `instrumentIds`.
+struct PortfolioReport
+{
+    std::vector<std::int64_t> time;
+    std::vector<double> equity;
+    std::vector<double> drawdown;
+
+    std::vector<std::size_t> instrumentIds;
+    std::vector<double> instrumentPnl;
+    std::vector<double> instrumentPosition;
+    std::vector<double> instrumentFees;
+    std::vector<double> instrumentNotional;
+
+    std::size_t fills = 0;
+    double totalPnl = 0.0;
+    double fees = 0.0;
+    double tradedNotional = 0.0;
+    double turnover = std::numeric_limits<double>::quiet_NaN();
+    double maxDrawdown = 0.0;
+    double maxDrawdownFraction = 0.0;
+    double sharpe = std::numeric_limits<double>::quiet_NaN();
+    double sortino = std::numeric_limits<double>::quiet_NaN();
+};
+
+/// \class PortfolioMetrics
+///     Equity curve, drawdown, Sharpe/Sortino, turnover and per-instrument PnL maintained incrementally as fills and
+///     marks stream in, at O(1) cost per event.  Fills also mark their instrument at the fill price.  Period returns
+///     are equity changes relative to the initial capital, or absolute PnL changes when no capital is given.  Sharpe
+///     and Sortino ratios are only computed with a sampling period, since per-event returns cannot be annualised.
+///     Instrument ids may be sparse, such as exchange ids.  Events must arrive in time order.
+class PortfolioMetrics
+{
+public:
+    explicit PortfolioMetrics(MetricsOptions const& options = {})
+        : mOptions(options)
+        , mEquity(options.initialCapital)
+        , mPeak(options.initialCapital)
+        , mSampledEquity(options.initialCapital)
+    {
+        if (mOptions.period < 0 || mOptions.periodsPerYear <= 0.0)
+            throw std::invalid_argument("Metrics period must be non-negative and periods per year positive");
+    }
+
+    void onFill(Fill const& fill)
+    {
+        advanceTo(fill.time);
+
+        auto& instrument = instrumentAt(fill.instrument);
+        mark(instrument, fill.price);
+        if (fill.quantity != 0.0 || fill.fee != 0.0)
+        {
+            auto const notional = fill.quantity * fill.price;
+            instrument.position += fill.quantity;
+            instrument.cash -= notional + fill.fee;
+            instrument.fees += fill.fee;
+            instrument.notional += std::abs(notional);
+            mEquity -= fill.fee;
+            mFees += fill.fee;
+            mTradedNotional += std::abs(notional);
+            ++mFills;
+        }
+        updateDrawdown();
+
+        if (mOptions.period == 0)
+            sample(fill.time);
+    }
+
+    void onMark(std::int64_t const time, std::size_t const instrument, double const price)
+    {
+        onFill(Fill{time, instrument, 0.0, price, 0.0});
+    }
+
+    double equity() const { return mEquity; }
+    double maxDrawdown() const { return mMaxDrawdown; }
+
+    /// Snapshot of the results so far, treating the current period as complete.
+    PortfolioReport report() const&
+    {
+        auto copy = *this;
+        return std::move(copy).report();
+    }
+
+    PortfolioReport report() &&
+    {
+        if (mPeriod)
+            sample(*mPeriod * mOptions.period);
+
+        auto const annualise = std::sqrt(mOptions.periodsPerYear);
+        auto const returns = static_cast<double>(mReturnCount);
+
+        PortfolioReport result;
+        result.time = std::move(mTime);
+        result.equity = std::move(mEquityCurve);
+        result.drawdown = std::move(mDrawdownCurve);
+        result.instrumentIds = std::move(mInstrumentIds);
+        for (auto const& instrument : mInstruments)
+        {
+            result.instrumentPnl.push_back(instrument.cash + instrument.position * instrument.price);
+            result.instrumentPosition.push_back(instrument.position);
+            result.instrumentFees.push_back(instrument.fees);
+            result.instrumentNotional.push_back(instrument.notional);
+        }
+        result.fills = mFills;
+        result.totalPnl = mEquity - mOptions.initialCapital;
+        result.fees = mFees;
+        result.tradedNotional = mTradedNotional;
+        if (mOptions.initialCapital > 0.0)
+            result.turnover = mTradedNotional / mOptions.initialCapital;
+        result.maxDrawdown = mMaxDrawdown;
+        result.maxDrawdownFraction = mMaxDrawdownFraction;
+        if (mOptions.period > 0 && mReturnCount > 1 && mReturnM2 > 0.0)
+            result.sharpe = mReturnMean / std::sqrt(mReturnM2 / (returns - 1.0)) * annualise;
+        if (mOptions.period > 0 && mReturnCount > 0 && mDownsideSquares > 0.0)
+            result.sortino = mReturnMean / std::sqrt(mDownsideSquares / returns) * annualise;
+        return result;
+    }
+
+private:
+    struct Instrument
+    {
+        double position = 0.0;
+        double price = 0.0;
+        double cash = 0.0;
+        double fees = 0.0;
+        double notional = 0.0;
+    };
+
+    // Ids map to dense indices so that sparse ids cost one entry each; consecutive events for the same instrument
+    // skip the lookup
+    Instrument& instrumentAt(std::size_t const id)
+    {
+        if (mInstruments.empty() || id != mInstrumentIds[mLastIndex])
+        {
+            auto [position, inserted] = mIndex.try_emplace(id, mInstruments.size());
+            if (inserted)
+            {
+                mInstruments.emplace_back();
+                mInstrumentIds.push_back(id);
+            }
+            mLastIndex = position->second;
+        }
+        return mInstruments[mLastIndex];
+    }
+
+    void mark(Instrument& instrument, double const price)
+    {
+        mEquity += instrument.position * (price - instrument.price);
+        instrument.price = price;
+    }
+
+    void updateDrawdown()
+    {
+        mPeak = std::max(mPeak, mEquity);
+        auto const drawdown = mPeak - mEquity;
+        mMaxDrawdown = std::max(mMaxDrawdown, drawdown);
+        if (mPeak > 0.0)
+            mMaxDrawdownFraction = std::max(mMaxDrawdownFraction, drawdown / mPeak);
+    }
+
+    // Close any periods that end before `time`; empty periods contribute a zero return
+    void advanceTo(std::int64_t const time)
+    {
+        if (mLastTime && time < *mLastTime)
+            throw std::invalid_argument("Metrics events must be in time order");
+        mLastTime = time;
+
+        if (mOptions.period == 0)
+            return;
+
+        auto const period = time / mOptions.period - (time % mOptions.period < 0 ? 1 : 0);
+        if (mPeriod)
+            for (; *mPeriod < period; ++*mPeriod)
+                sample(*mPeriod * mOptions.period);
+        mPeriod = period;
+    }
+
+    void sample(std::int64_t const time)
+    {
+        auto const scale = mOptions.initialCapital > 0.0 ? mOptions.initialCapital : 1.0;
+        auto const value = (mEquity - mSampledEquity) / scale;
+        mSampledEquity = mEquity;
+
+        ++mReturnCount;
+        auto const delta = value - mReturnMean;
+        mReturnMean += delta / static_cast<double>(mReturnCount);
+        mReturnM2 += delta * (value - mReturnMean);
+        if (value < 0.0)
+            mDownsideSquares += value * value;
+
+        mTime.push_back(time);
+        mEquityCurve.push_back(mEquity);
+        mDrawdownCurve.push_back(mEquity - mPeak);
+    }
+
+    MetricsOptions mOptions;
+    std::vector<Instrument> mInstruments;
+    std::vector<std::size_t> mInstrumentIds;
+    std::unordered_map<std::size_t, std::size_t> mIndex;
+    std::size_t mLastIndex = 0;
+
+    double mEquity;
+    double mPeak;
+    double mMaxDrawdown = 0.0;
+    double mMaxDrawdownFraction = 0.0;
+    double mFees = 0.0;
+    double mTradedNotional = 0.0;
+    std::size_t mFills = 0;
+
+    std::optional<std::int64_t> mLastTime;
+    std::optional<std::int64_t> mPeriod;
+    double mSampledEquity;
+    std::size_t mReturnCount = 0;
+    double mReturnMean = 0.0;
+    double mReturnM2 = 0.0;
+    double mDownsideSquares = 0.0;
+
+    std::vector<std::int64_t> mTime;
+    std::vector<double> mEquityCurve;
+    std::vector<double> mDrawdownCurve;
+};
+
+/// Metrics over fill columns in one pass.  Rows with zero quantity are marks; `fee` may be empty.
+template<std::integral InstrumentId, typename Quantity>
+PortfolioReport portfolioMetrics(
+    std::span<std::int64_t const> const time,
+    std::span<InstrumentId const> const instrument,
+    std::span<Quantity const> const quantity,
+    std::span<double const> const price,
+    std::span<double const> const fee,
+    MetricsOptions const& options = {})
+{
+    auto const rows = time.size();
+    if (instrument.size() != rows || quantity.size() != rows || price.size() != rows || (!fee.empty() && fee.size() != rows))
+        throw std::invalid_argument("Fill columns must have equal length");
+
+    PortfolioMetrics metrics(options);
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+        if constexpr (std::is_signed_v<InstrumentId>)
+            if (instrument[i] < 0)
+                throw std::invalid_argument("Instrument ids must be non-negative");
+        metrics.onFill(Fill{
+            time[i],
+            static_cast<std::size_t>(instrument[i]),
+            static_cast<double>(quantity[i]),
+            price[i],
+            fee.empty() ? 0.0 : fee[i]});
+    }
+    return std::move(metrics).report();
+}
+
+}    // namespace profitview
@@ -0,0 +1,258 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include "format.hpp"
+#include "pipeline.hpp"
+
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/arrow/schema.h>
+#include <parquet/exception.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace profitview
+{
+
+/// \struct RowGroupBytes
+///     The raw, still compressed, bytes of one row group's column chunks as read from disk.
+struct RowGroupBytes
+{
+    int index = 0;
+    std::int64_t offset = 0;    ///< File offset of the first byte of `bytes`
+    std::shared_ptr<arrow::Buffer> bytes;
+};
+
+namespace row_group_stream_detail
+{
+
+/// \class PrefetchedFile
+///     A file whose bytes from `offset` are already in memory: reads within them are zero-copy slices, anything
+///     else (such as padding some writers' offsets need) falls through to the underlying file.
+class PrefetchedFile : public arrow::io::RandomAccessFile
+{
+public:
+    PrefetchedFile(
+        std::shared_ptr<arrow::io::RandomAccessFile> file,
+        std::int64_t const size,
+        std::int64_t const offset,
+        std::shared_ptr<arrow::Buffer> bytes)
+        : mFile(std::move(file))
+        , mSize(size)
+        , mOffset(offset)
+        , mBytes(std::move(bytes))
+    {}
+
+    arrow::Status Close() override
+    {
+        mClosed = true;
+        return arrow::Status::OK();
+    }
+
+    bool closed() const override { return mClosed; }
+    arrow::Result<std::int64_t> Tell() const override { return mPosition; }
+    arrow::Result<std::int64_t> GetSize() override { return mSize; }
+
+    arrow::Status Seek(std::int64_t const position) override
+    {
+        if (position < 0 || position > mSize)
+            return arrow::Status::IOError("Seek out of bounds");
+        mPosition = position;
+        return arrow::Status::OK();
+    }
+
+    arrow::Result<std::int64_t> Read(std::int64_t const nbytes, void* const out) override
+    {
+        ARROW_ASSIGN_OR_RAISE(auto const read, ReadAt(mPosition, nbytes, out));
+        mPosition += read;
+        return read;
+    }
+
+    arrow::Result<std::shared_ptr<arrow::Buffer>> Read(std::int64_t const nbytes) override
+    {
+        ARROW_ASSIGN_OR_RAISE(auto buffer, ReadAt(mPosition, nbytes));
+        mPosition += buffer->size();
+        return buffer;
+    }
+
+    arrow::Result<std::int64_t> ReadAt(std::int64_t const position, std::int64_t nbytes, void* const out) override
+    {
+        nbytes = std::min(nbytes, mSize - position);
+        if (!contains(position, nbytes))
+            return mFile->ReadAt(position, nbytes, out);
+        std::memcpy(out, mBytes->data() + (position - mOffset), nbytes);
+        return nbytes;
+    }
+
+    arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(std::int64_t const position, std::int64_t nbytes) override
+    {
+        nbytes = std::min(nbytes, mSize - position);
+        if (!contains(position, nbytes))
+            return mFile->ReadAt(position, nbytes);
+        return arrow::SliceBuffer(mBytes, position - mOffset, nbytes);
+    }
+
+private:
+    bool contains(std::int64_t const position, std::int64_t const nbytes) const
+    {
+        return position >= mOffset && position + nbytes <= mOffset + mBytes->size();
+    }
+
+    std::shared_ptr<arrow::io::RandomAccessFile> mFile;
+    std::int64_t mSize;
+    std::int64_t mOffset;
+    std::shared_ptr<arrow::Buffer> mBytes;
+    std::int64_t mPosition = 0;
+    bool mClosed = false;
+};
+
+// [begin, end) of the file holding the chunks of `columns` (all columns when empty) in `rowGroup`
+inline std::pair<std::int64_t, std::int64_t> byteRange(
+    parquet::RowGroupMetaData const& rowGroup, std::vector<int> const& columns)
+{
+    auto begin = std::numeric_limits<std::int64_t>::max();
+    std::int64_t end = 0;
+    auto const add = [&](int const column)
+    {
+        auto const chunk = rowGroup.ColumnChunk(column);
+        auto const start = chunk->has_dictionary_page() && chunk->dictionary_page_offset() > 0
+                               ? std::min(chunk->dictionary_page_offset(), chunk->data_page_offset())
+                               : chunk->data_page_offset();
+        begin = std::min(begin, start);
+        end = std::max(end, start + chunk->total_compressed_size());
+    };
+
+    if (columns.empty())
+        for (int column = 0; column < rowGroup.num_columns(); ++column)
+            add(column);
+    for (auto const column : columns)
+        add(column);
+    return {std::min(begin, end), end};
+}
+
+}    // namespace row_group_stream_detail
+
+/// Arrow schema of a Parquet file from its already parsed footer, honouring any Arrow schema stored by the writer.
+inline std::shared_ptr<arrow::Schema> arrowSchema(parquet::FileMetaData const& metadata)
+{
+    std::shared_ptr<arrow::Schema> schema;
+    PARQUET_THROW_NOT_OK(parquet::arrow::FromParquetSchema(
+        metadata.schema(), parquet::ArrowReaderProperties{}, metadata.key_value_metadata(), &schema));
+    return schema;
+}
+
+/// \struct RowGroupStreamOptions
+///     Configuration of streamRowGroups.
+struct RowGroupStreamOptions
+{
+    std::vector<std::string> columns;    ///< Columns to read, all when empty
+    bool useThreads = true;              ///< Decode the columns of a row group in parallel on Arrow's CPU pool
+    PipelineOptions pipeline;
+};
+
+/// Stream the row groups of the Parquet `file` through runPipeline: one thread reads each row group's column chunks
+/// with a single large read, another decompresses and decodes them into an Arrow table, a third applies `transform`
+/// and `consume` receives the results in order on the calling thread.  Only `options.pipeline.depth` row groups
+/// queue between stages, so memory stays bounded by the row group size rather than the file size.
+/// `metadata` is the file's parsed footer, for callers which have already read it.
+template<typename Transform, typename Consume>
+void streamRowGroups(
+    std::shared_ptr<arrow::io::RandomAccessFile> const& file,
+    std::shared_ptr<parquet::FileMetaData> const& metadata,
+    Transform&& transform,
+    Consume&& consume,
+    RowGroupStreamOptions const& options = {})
+{
+    using namespace row_group_stream_detail;
+
+    std::int64_t size = 0;
+    PARQUET_ASSIGN_OR_THROW(size, file->GetSize());
+
+    std::vector<int> columns;
+    for (auto const& name : options.columns)
+    {
+        auto const column = metadata->schema()->ColumnIndex(name);
+        if (column < 0)
+            throw std::runtime_error(fmt_ns::format("No column named '{}'", name));
+        columns.push_back(column);
+    }
+
+    parquet::ArrowReaderProperties properties;
+    properties.set_use_threads(options.useThreads);
+
+    int next = 0;
+    runPipeline(
+        [&]() -> std::optional<RowGroupBytes>
+        {
+            if (next == metadata->num_row_groups())
+                return std::nullopt;
+            auto const [begin, end] = byteRange(*metadata->RowGroup(next), columns);
+            RowGroupBytes rowGroup{next++, begin, nullptr};
+            PARQUET_ASSIGN_OR_THROW(rowGroup.bytes, file->ReadAt(begin, end - begin));
+            return rowGroup;
+        },
+        [&](RowGroupBytes rowGroup)
+        {
+            auto const source = std::make_shared<PrefetchedFile>(file, size, rowGroup.offset, std::move(rowGroup.bytes));
+            std::unique_ptr<parquet::arrow::FileReader> reader;
+            PARQUET_THROW_NOT_OK(parquet::arrow::FileReader::Make(
+                arrow::default_memory_pool(),
+                parquet::ParquetFileReader::Open(source, parquet::default_reader_properties(), metadata),
+                properties,
+                &reader));
+
+            std::shared_ptr<arrow::Table> table;
+            if (columns.empty())
+            {
+                PARQUET_THROW_NOT_OK(reader->ReadRowGroup(rowGroup.index, &table));
+            }
+            else
+            {
+                PARQUET_THROW_NOT_OK(reader->ReadRowGroup(rowGroup.index, columns, &table));
+            }
+            return table;
+        },
+        std::forward<Transform>(transform),
+        std::forward<Consume>(consume),
+        options.pipeline);
+}
+
+template<typename Transform, typename Consume>
+void streamRowGroups(
+    std::shared_ptr<arrow::io::RandomAccessFile> const& file,
+    Transform&& transform,
+    Consume&& consume,
+    RowGroupStreamOptions const& options = {})
+{
+    streamRowGroups(
+        file, parquet::ReadMetaData(file), std::forward<Transform>(transform), std::forward<Consume>(consume), options);
+}
+
+}    // namespace profitview
@@ -0,0 +1,177 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include "format.hpp"
+
+#include <arrow/api.h>
+#include <arrow/compute/api.h>
+#include <arrow/type_traits.h>
+#include <parquet/exception.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace profitview
+{
+
+namespace schema_resolution_detail
+{
+
+inline std::shared_ptr<arrow::DataType> integerOfWidth(int const bits, bool const isSigned)
+{
+    switch (bits)
+    {
+    case 8: return isSigned ? arrow::int8() : arrow::uint8();
+    case 16: return isSigned ? arrow::int16() : arrow::uint16();
+    case 32: return isSigned ? arrow::int32() : arrow::uint32();
+    default: return isSigned ? arrow::int64() : arrow::uint64();
+    }
+}
+
+inline int bitWidth(arrow::DataType const& type)
+{
+    return static_cast<arrow::FixedWidthType const&>(type).bit_width();
+}
+
+}    // namespace schema_resolution_detail
+
+/// Type values of both `a` and `b` can be cast to, or nullptr when there is none.  Integers widen to the wider
+/// (signed, when signedness differs) integer without loss of range; uint64 has no signed counterpart, so it is
+/// incompatible with signed integers.  Integers mixed with floating point widen to double, which holds integers only
+/// up to 2^53 exactly: conformTable's safe cast then rejects larger 64-bit values rather than round them.  Timestamps
+/// widen to the finer unit and strings to large strings.
+inline std::shared_ptr<arrow::DataType> commonType(
+    std::shared_ptr<arrow::DataType> const& a, std::shared_ptr<arrow::DataType> const& b)
+{
+    using namespace schema_resolution_detail;
+
+    if (a->Equals(*b))
+        return a;
+    if (a->id() == arrow::Type::NA)
+        return b;
+    if (b->id() == arrow::Type::NA)
+        return a;
+
+    auto const aId = a->id();
+    auto const bId = b->id();
+    if (arrow::is_integer(aId) && arrow::is_integer(bId))
+    {
+        auto const aSigned = arrow::is_signed_integer(aId);
+        auto const bSigned = arrow::is_signed_integer(bId);
+        if (aSigned == bSigned)
+            return integerOfWidth(std::max(bitWidth(*a), bitWidth(*b)), aSigned);
+        // The unsigned side needs one more bit once it is signed, which uint64 cannot have
+        auto const unsignedBits = bitWidth(aSigned ? *b : *a);
+        auto const signedBits = bitWidth(aSigned ? *a : *b);
+        if (unsignedBits == 64)
+            return nullptr;
+        return integerOfWidth(std::max(signedBits, unsignedBits * 2), true);
+    }
+    if ((arrow::is_integer(aId) || arrow::is_floating(aId)) && (arrow::is_integer(bId) || arrow::is_floating(bId)))
+        return arrow::float64();
+    if (aId == arrow::Type::TIMESTAMP && bId == arrow::Type::TIMESTAMP)
+    {
+        auto const& aTimestamp = static_cast<arrow::TimestampType const&>(*a);
+        auto const& bTimestamp = static_cast<arrow::TimestampType const&>(*b);
+        if (aTimestamp.timezone() != bTimestamp.timezone())
+            return nullptr;
+        return arrow::timestamp(std::max(aTimestamp.unit(), bTimestamp.unit()), aTimestamp.timezone());
+    }
+    if ((aId == arrow::Type::STRING || aId == arrow::Type::LARGE_STRING) &&
+        (bId == arrow::Type::STRING || bId == arrow::Type::LARGE_STRING))
+        return arrow::large_utf8();
+    return nullptr;
+}
+
+/// Target schema for reading tables with the given schemas together.  Fields keep the order in which they are first
+/// seen; a field missing from any schema becomes nullable.  Throws when a field has incompatible types.
+inline std::shared_ptr<arrow::Schema> resolveSchema(std::vector<std::shared_ptr<arrow::Schema>> const& schemas)
+{
+    if (schemas.empty())
+        throw std::invalid_argument("No schemas to resolve");
+
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    std::unordered_map<std::string, std::size_t> index;
+    std::vector<std::size_t> seen;
+    for (auto const& schema : schemas)
+    {
+        for (auto const& field : schema->fields())
+        {
+            auto [position, inserted] = index.try_emplace(field->name(), fields.size());
+            if (inserted)
+            {
+                fields.push_back(field);
+                seen.push_back(1);
+                continue;
+            }
+
+            auto& target = fields[position->second];
+            auto type = commonType(target->type(), field->type());
+            if (!type)
+                throw std::runtime_error(fmt_ns::format(
+                    "Field '{}' has incompatible types {} and {}",
+                    field->name(),
+                    target->type()->ToString(),
+                    field->type()->ToString()));
+            if (!type->Equals(*target->type()))
+                target = target->WithType(type);
+            if (field->nullable() && !target->nullable())
+                target = target->WithNullable(true);
+            ++seen[position->second];
+        }
+    }
+
+    for (std::size_t i = 0; i < fields.size(); ++i)
+        if (seen[i] < schemas.size() && !fields[i]->nullable())
+            fields[i] = fields[i]->WithNullable(true);
+
+    return arrow::schema(std::move(fields), schemas.front()->metadata());
+}
+
+/// Cast the columns of `table` to `target` in bulk with Arrow compute kernels, adding all-null columns for fields
+/// the table lacks.  Nulls are preserved.
+inline std::shared_ptr<arrow::Table> conformTable(
+    std::shared_ptr<arrow::Table> const& table, std::shared_ptr<arrow::Schema> const& target)
+{
+    std::vector<std::shared_ptr<arrow::ChunkedArray>> columns;
+    columns.reserve(target->num_fields());
+    for (auto const& field : target->fields())
+    {
+        auto column = table->GetColumnByName(field->name());
+        if (!column)
+        {
+            std::shared_ptr<arrow::Array> nulls;
+            PARQUET_ASSIGN_OR_THROW(nulls, arrow::MakeArrayOfNull(field->type(), table->num_rows()));
+            column = std::make_shared<arrow::ChunkedArray>(nulls);
+        }
+        else if (!column->type()->Equals(*field->type()))
+        {
+            arrow::Datum cast;
+            PARQUET_ASSIGN_OR_THROW(cast, arrow::compute::Cast(column, field->type()));
+            column = cast.chunked_array();
+        }
+        columns.push_back(std::move(column));
+    }
+    return arrow::Table::Make(target, std::move(columns), table->num_rows());
+}
+
+}    // namespace profitview
@@ -0,0 +1,479 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace profitview
+{
+
+/// \struct Tick
+///     A single trade print as replayed to a strategy.
+struct Tick
+{
+    std::int64_t time = 0;
+    double price = 0.0;
+    std::int64_t size = 0;
+};
+
+/// \struct TickBlock
+///     Structure-of-arrays buffer one block of a TickStore decodes into.  Reuse the same instance across calls to
+///     TickStore::decodeBlock so replay does not allocate.
+struct TickBlock
+{
+    std::vector<std::int64_t> times;
+    std::vector<double> prices;
+    std::vector<std::int64_t> sizes;
+
+    std::size_t count() const { return times.size(); }
+    Tick operator[](std::size_t const i) const { return Tick{times[i], prices[i], sizes[i]}; }
+
+private:
+    friend class TickStore;
+    std::vector<std::uint64_t> mScratch;
+};
+
+namespace tick_store_detail
+{
+
+inline std::uint64_t zigZagEncode(std::int64_t const value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t zigZagDecode(std::uint64_t const value)
+{
+    return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+inline void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+inline std::uint64_t getVarint(std::uint8_t const*& in, std::uint8_t const* const end)
+{
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        if (in == end)
+            throw std::runtime_error("Truncated tick store block");
+        auto const byte = *in++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw std::runtime_error("Malformed varint in tick store block");
+}
+
+/// Decode `count` LEB128 varints.  Runs of eight single byte values (the common case for delta encoded ticks) are
+/// detected with one 64-bit load and expanded without per-byte branching, the rest fall back to the scalar decoder.
+inline void getVarints(std::uint8_t const*& in, std::uint8_t const* const end, std::uint64_t* out, std::size_t count)
+{
+    constexpr std::uint64_t continuationBits = 0x8080808080808080ull;
+    std::size_t i = 0;
+    while (i < count)
+    {
+        if (count - i >= 8 && end - in >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, in, sizeof(word));
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                if ((word & continuationBits) == 0)
+                {
+                    for (unsigned j = 0; j < 8; ++j)
+                        out[i + j] = (word >> (8 * j)) & 0xff;
+                    in += 8;
+                    i += 8;
+                    continue;
+                }
+            }
+        }
+        out[i++] = getVarint(in, end);
+    }
+}
+
+inline std::uint64_t loadLittleEndian(std::uint8_t const* const in)
+{
+    std::uint64_t word = 0;
+    if constexpr (std::endian::native == std::endian::little)
+        std::memcpy(&word, in, sizeof(word));
+    else
+        for (unsigned j = 0; j < 8; ++j)
+            word |= std::uint64_t{in[j]} << (8 * j);
+    return word;
+}
+
+/// Bytes putPacked writes for `count` values of `width` bits: the packed bits plus padding which lets the unpacker
+/// load any value with a single unaligned 64-bit read.
+inline std::size_t packedBytes(std::size_t const count, unsigned const width)
+{
+    return width == 0 ? 0 : (count * width + 7) / 8 + sizeof(std::uint64_t);
+}
+
+/// Append `count` values, each less than 2^width, as a little endian bit stream of fixed `width` bit fields.
+inline void putPacked(std::vector<std::uint8_t>& out, std::uint64_t const* const values, std::size_t const count, unsigned const width)
+{
+    if (width == 0)
+        return;
+    auto const start = out.size();
+    out.resize(start + packedBytes(count, width), 0);
+    auto* const bytes = out.data() + start;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto const bit = i * width;
+        auto* const field = bytes + bit / 8;
+        auto const shift = static_cast<unsigned>(bit % 8);
+        auto value = values[i];
+        field[0] |= static_cast<std::uint8_t>(value << shift);
+        value >>= 8 - shift;
+        for (unsigned filled = 8 - shift, k = 1; filled < width; filled += 8, ++k, value >>= 8)
+            field[k] |= static_cast<std::uint8_t>(value);
+    }
+}
+
+/// Unpack `count` fixed width values written by putPacked.  Up to 56 bits every value is one unaligned load, a shift
+/// and a mask, independent of its neighbours, so unlike varints the loop has no per-value branches and pipelines
+/// (or vectorises) freely.
+inline void getPacked(
+    std::uint8_t const*& in, std::uint8_t const* const end, std::uint64_t* const out, std::size_t const count, unsigned const width)
+{
+    if (width > 64)
+        throw std::runtime_error("Malformed bit width in tick store block");
+    auto const bytes = packedBytes(count, width);
+    if (static_cast<std::size_t>(end - in) < bytes)
+        throw std::runtime_error("Truncated tick store block");
+    if (width == 0)
+    {
+        std::fill_n(out, count, std::uint64_t{0});
+        return;
+    }
+
+    auto const mask = width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+    if (width <= 56)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto const bit = i * width;
+            out[i] = (loadLittleEndian(in + bit / 8) >> (bit % 8)) & mask;
+        }
+    }
+    else
+    {
+        // Fields can span nine bytes, more than one load holds
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto const bit = i * width;
+            auto const* const field = in + bit / 8;
+            auto const shift = static_cast<unsigned>(bit % 8);
+            std::uint64_t value = field[0] >> shift;
+            for (unsigned filled = 8 - shift, k = 1; filled < width; filled += 8, ++k)
+                value |= std::uint64_t{field[k]} << filled;
+            out[i] = value & mask;
+        }
+    }
+    in += bytes;
+}
+
+template<typename T>
+void prefixSum(T* values, std::size_t const count)
+{
+    for (std::size_t i = 1; i < count; ++i)
+        values[i] += values[i - 1];
+}
+
+}    // namespace tick_store_detail
+
+/// \class TickStore
+///     Compressed in-memory columnar store of ticks for long horizon replay.  Ticks are appended in time order and
+///     packed into fixed size blocks, each of which is encoded independently:
+///       - time:  the first time, then each delta less the block's smallest delta, bit-packed at the block's fixed
+///                width so that decoding needs no per-value branches; evenly spaced times take no space at all
+///       - price: integer ticks (price * priceScale) delta encoded when every price in the block round trips exactly,
+///                otherwise the XOR of consecutive IEEE-754 bit patterns
+///       - size:  zig-zag varint
+///     The XOR fallback only drops the leading zero bits of each word: decimal prices such as 100.01 differ in some
+///     45 low order mantissa bits, so unscaled prices still cost 6-7 bytes each and a store of them shrinks only about
+///     3x overall.  With a priceScale matching the instrument's tick size prices and sizes take a byte or two per tick
+///     and the timestamps dominate: nanosecond trades some milliseconds apart need about 26 bits each, so a store of
+///     them is about 4.4x smaller; millisecond resolution times reach about 8x and regular intervals about 10x.
+///     Decoding is lossless.  The last partially filled block is kept uncompressed until it fills or seal() is called.
+class TickStore
+{
+public:
+    /// Number of ticks per block; 4096 ticks decode into 96KiB of structure-of-arrays which stays cache resident.
+    static constexpr std::size_t blockSize = 4096;
+
+    /// \param priceScale Number of price ticks per unit of price (e.g. 100 for a 0.01 tick size).  Without it every
+    ///     block uses XOR encoding for prices.
+    explicit TickStore(std::optional<std::int64_t> const priceScale = std::nullopt)
+        : mPriceScale(priceScale)
+    {
+        if (mPriceScale && *mPriceScale <= 0)
+            throw std::invalid_argument("Price scale must be positive");
+        mPending.times.reserve(blockSize);
+        mPending.prices.reserve(blockSize);
+        mPending.sizes.reserve(blockSize);
+    }
+
+    void append(Tick const& tick)
+    {
+        mPending.times.push_back(tick.time);
+        mPending.prices.push_back(tick.price);
+        mPending.sizes.push_back(tick.size);
+        if (mPending.count() == blockSize)
+            flush();
+    }
+
+    void append(
+        std::span<std::int64_t const> const times,
+        std::span<double const> const prices,
+        std::span<std::int64_t const> const sizes)
+    {
+        if (times.size() != prices.size() || times.size() != sizes.size())
+            throw std::invalid_argument("Tick columns must have equal length");
+        for (std::size_t i = 0; i < times.size(); ++i)
+            append(Tick{times[i], prices[i], sizes[i]});
+    }
+
+    /// Encode any pending ticks as a (possibly short) block and release spare capacity.
+    void seal()
+    {
+        flush();
+        mData.shrink_to_fit();
+        mBlocks.shrink_to_fit();
+    }
+
+    std::size_t size() const { return mTickCount + mPending.count(); }
+    std::size_t blockCount() const { return mBlocks.size() + (mPending.count() > 0 ? 1 : 0); }
+
+    /// Bytes held by encoded blocks, their index and the pending uncompressed tail.
+    std::size_t compressedBytes() const
+    {
+        return mData.size() + mBlocks.size() * sizeof(BlockHeader) + mPending.count() * sizeof(Tick);
+    }
+
+    std::size_t uncompressedBytes() const { return size() * sizeof(Tick); }
+
+    /// Bytes allocated for encoded blocks, including capacity reserved for further appends until seal().
+    std::size_t reservedBytes() const { return mData.capacity(); }
+
+    void decodeBlock(std::size_t const index, TickBlock& block) const
+    {
+        using namespace tick_store_detail;
+
+        if (index >= blockCount())
+            throw std::out_of_range("Tick store block index out of range");
+        if (index == mBlocks.size())
+        {
+            block.times = mPending.times;
+            block.prices = mPending.prices;
+            block.sizes = mPending.sizes;
+            return;
+        }
+
+        auto const& header = mBlocks[index];
+        auto const count = static_cast<std::size_t>(header.count);
+        auto const* in = mData.data() + header.offset;
+        auto const* const end = index + 1 < mBlocks.size() ? mData.data() + mBlocks[index + 1].offset
+                                                            : mData.data() + mData.size();
+        block.times.resize(count);
+        block.prices.resize(count);
+        block.sizes.resize(count);
+        block.mScratch.resize(count);
+        auto* const scratch = block.mScratch.data();
+
+        // Times: t0, minimum delta, width, packed (delta - minimum) -> deltas -> absolute times
+        auto* const times = reinterpret_cast<std::uint64_t*>(block.times.data());
+        times[0] = static_cast<std::uint64_t>(zigZagDecode(getVarint(in, end)));
+        if (count > 1)
+        {
+            auto const minimum = static_cast<std::uint64_t>(zigZagDecode(getVarint(in, end)));
+            if (in == end)
+                throw std::runtime_error("Truncated tick store block");
+            getPacked(in, end, times + 1, count - 1, *in++);
+            for (std::size_t i = 1; i < count; ++i)
+                times[i] += minimum;
+            prefixSum(times, count);
+        }
+
+        getVarints(in, end, scratch, count);
+        auto* const prices = block.prices.data();
+        if (header.encoding == PriceEncoding::Scaled)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                scratch[i] = static_cast<std::uint64_t>(zigZagDecode(scratch[i]));
+            prefixSum(scratch, count);
+            auto const scale = static_cast<double>(*mPriceScale);
+            for (std::size_t i = 0; i < count; ++i)
+                prices[i] = static_cast<double>(static_cast<std::int64_t>(scratch[i])) / scale;
+        }
+        else
+        {
+            for (std::size_t i = 1; i < count; ++i)
+                scratch[i] ^= scratch[i - 1];
+            for (std::size_t i = 0; i < count; ++i)
+                prices[i] = std::bit_cast<double>(scratch[i]);
+        }
+
+        getVarints(in, end, scratch, count);
+        auto* const sizes = block.sizes.data();
+        for (std::size_t i = 0; i < count; ++i)
+            sizes[i] = zigZagDecode(scratch[i]);
+    }
+
+    /// Decode block by block and hand each tick to `consumer` in time order.
+    template<std::invocable<Tick const&> Consumer>
+    void replay(Consumer&& consumer) const
+    {
+        TickBlock block;
+        for (std::size_t index = 0; index < blockCount(); ++index)
+        {
+            decodeBlock(index, block);
+            for (std::size_t i = 0; i < block.count(); ++i)
+                consumer(block[i]);
+        }
+    }
+
+private:
+    enum class PriceEncoding : std::uint8_t
+    {
+        Scaled,
+        Xor
+    };
+
+    struct BlockHeader
+    {
+        std::uint64_t offset = 0;
+        std::uint32_t count = 0;
+        PriceEncoding encoding = PriceEncoding::Xor;
+    };
+
+    // Encode the pending ticks, if any, as a block; the encoded data grows geometrically
+    void flush()
+    {
+        if (mPending.count() == 0)
+            return;
+        encodeBlock(mPending);
+        mPending.times.clear();
+        mPending.prices.clear();
+        mPending.sizes.clear();
+    }
+
+    bool scalePrices(std::vector<double> const& prices, std::vector<std::int64_t>& ticks) const
+    {
+        if (!mPriceScale)
+            return false;
+
+        // Keep well inside the exactly representable integer range of a double
+        constexpr double limit = static_cast<double>(std::int64_t{1} << 52);
+        auto const scale = static_cast<double>(*mPriceScale);
+        ticks.clear();
+        for (auto const price : prices)
+        {
+            auto const scaled = price * scale;
+            if (!std::isfinite(scaled) || std::abs(scaled) >= limit)
+                return false;
+            auto const tick = std::llround(scaled);
+            if (static_cast<double>(tick) / scale != price)
+                return false;
+            ticks.push_back(tick);
+        }
+        return true;
+    }
+
+    void encodeBlock(TickBlock const& block)
+    {
+        using namespace tick_store_detail;
+
+        auto const count = block.count();
+        BlockHeader header{mData.size(), static_cast<std::uint32_t>(count), PriceEncoding::Xor};
+
+        putVarint(mData, zigZagEncode(block.times[0]));
+        if (count > 1)
+        {
+            // Deltas wrap like the decoder's prefix sum, so out of order times round trip too
+            std::vector<std::uint64_t> offsets(count - 1);
+            auto minimum = std::numeric_limits<std::int64_t>::max();
+            for (std::size_t i = 1; i < count; ++i)
+            {
+                offsets[i - 1] = static_cast<std::uint64_t>(block.times[i]) - static_cast<std::uint64_t>(block.times[i - 1]);
+                minimum = std::min(minimum, static_cast<std::int64_t>(offsets[i - 1]));
+            }
+            std::uint64_t range = 0;
+            for (auto& offset : offsets)
+                range |= offset -= static_cast<std::uint64_t>(minimum);
+            auto const width = static_cast<unsigned>(64 - std::countl_zero(range));
+            putVarint(mData, zigZagEncode(minimum));
+            mData.push_back(static_cast<std::uint8_t>(width));
+            putPacked(mData, offsets.data(), offsets.size(), width);
+        }
+
+        std::vector<std::int64_t> ticks;
+        ticks.reserve(count);
+        if (scalePrices(block.prices, ticks))
+        {
+            header.encoding = PriceEncoding::Scaled;
+            std::int64_t previous = 0;
+            for (auto const tick : ticks)
+            {
+                putVarint(mData, zigZagEncode(tick - previous));
+                previous = tick;
+            }
+        }
+        else
+        {
+            std::uint64_t previous = 0;
+            for (auto const price : block.prices)
+            {
+                auto const bits = std::bit_cast<std::uint64_t>(price);
+                putVarint(mData, bits ^ previous);
+                previous = bits;
+            }
+        }
+
+        for (auto const size : block.sizes)
+            putVarint(mData, zigZagEncode(size));
+
+        mBlocks.push_back(header);
+        mTickCount += count;
+    }
+
+    std::optional<std::int64_t> mPriceScale;
+    std::vector<std::uint8_t> mData;
+    std::vector<BlockHeader> mBlocks;
+    std::size_t mTickCount = 0;
+    TickBlock mPending;
+};
+
+}    // namespace profitview
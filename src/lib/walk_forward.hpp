@@ -0,0 +1,309 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include "ranges.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace profitview
+{
+
+/// \struct RowRange
+///     Half open range of row indices [begin, end) into a time ordered dataset.
+struct RowRange
+{
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    std::size_t size() const { return end - begin; }
+    bool empty() const { return begin == end; }
+
+    template<typename T>
+    std::span<T> of(std::span<T> const column) const
+    {
+        return column.subspan(begin, size());
+    }
+};
+
+/// \struct Fold
+///     One train/test split.  `trainAfter` holds training rows following the test window and is only non-empty for
+///     k-fold cross-validation.
+struct Fold
+{
+    RowRange train;
+    RowRange test;
+    RowRange trainAfter;
+};
+
+/// \struct WalkForwardOptions
+///     Window lengths are in the units of the time index (e.g. nanoseconds for Arrow timestamps).
+struct WalkForwardOptions
+{
+    std::int64_t train = 0;    ///< Length of each training window
+    std::int64_t test = 0;     ///< Length of each test window
+    std::int64_t step = 0;     ///< Distance between consecutive test windows, defaults to `test`
+    std::int64_t purge = 0;    ///< Gap dropped between the end of training data and the start of the test window
+    bool anchored = false;     ///< Expanding training windows which all start at the first observation
+};
+
+namespace walk_forward_detail
+{
+
+inline std::size_t rowAt(std::span<std::int64_t const> const time, std::int64_t const value)
+{
+    return static_cast<std::size_t>(ranges::lower_bound(time, value) - time.begin());
+}
+
+}    // namespace walk_forward_detail
+
+/// \class WalkForwardSplitter
+///     Rolling (or anchored) walk-forward folds over a sorted time index.  Folds are computed on demand by binary
+///     search, nothing is copied; apply the returned row ranges to any column to get zero-copy views.  The final test
+///     window may be truncated by the end of the data.
+class WalkForwardSplitter
+{
+public:
+    WalkForwardSplitter(std::span<std::int64_t const> const time, WalkForwardOptions const& options)
+        : mTime(time)
+        , mOptions(options)
+    {
+        if (mOptions.step == 0)
+            mOptions.step = mOptions.test;
+        if (mOptions.train <= 0 || mOptions.test <= 0 || mOptions.step <= 0 || mOptions.purge < 0)
+            throw std::invalid_argument("Walk-forward window lengths must be positive and the purge non-negative");
+        if (!ranges::is_sorted(mTime))
+            throw std::invalid_argument("Walk-forward time index must be sorted");
+
+        if (!mTime.empty())
+        {
+            auto const firstTest = mTime.front() + mOptions.train + mOptions.purge;
+            if (firstTest <= mTime.back())
+                mCount = static_cast<std::size_t>((mTime.back() - firstTest) / mOptions.step) + 1;
+        }
+    }
+
+    std::size_t count() const { return mCount; }
+
+    Fold operator[](std::size_t const index) const
+    {
+        using walk_forward_detail::rowAt;
+
+        if (index >= mCount)
+            throw std::out_of_range("Fold index out of range");
+
+        auto const origin = mTime.front();
+        auto const testStart = origin + mOptions.train + mOptions.purge + static_cast<std::int64_t>(index) * mOptions.step;
+        auto const trainEnd = testStart - mOptions.purge;
+        auto const trainStart = mOptions.anchored ? origin : trainEnd - mOptions.train;
+
+        return Fold{
+            RowRange{rowAt(mTime, trainStart), rowAt(mTime, trainEnd)},
+            RowRange{rowAt(mTime, testStart), rowAt(mTime, testStart + mOptions.test)},
+            RowRange{mTime.size(), mTime.size()}};
+    }
+
+private:
+    std::span<std::int64_t const> mTime;
+    WalkForwardOptions mOptions;
+    std::size_t mCount = 0;
+};
+
+/// \class PurgedKFoldSplitter
+///     K-fold cross-validation over contiguous blocks of rows.  Training rows whose time falls within `purge` before
+///     the test window, or within `embargo` after it, are dropped to limit leakage between overlapping labels.
+class PurgedKFoldSplitter
+{
+public:
+    PurgedKFoldSplitter(
+        std::span<std::int64_t const> const time,
+        std::size_t const folds,
+        std::int64_t const purge = 0,
+        std::int64_t const embargo = 0)
+        : mTime(time)
+        , mFolds(folds)
+        , mPurge(purge)
+        , mEmbargo(embargo)
+    {
+        if (mFolds < 2 || mFolds > mTime.size())
+            throw std::invalid_argument("K-fold requires between 2 and the number of rows folds");
+        if (mPurge < 0 || mEmbargo < 0)
+            throw std::invalid_argument("Purge and embargo must be non-negative");
+        if (!ranges::is_sorted(mTime))
+            throw std::invalid_argument("K-fold time index must be sorted");
+    }
+
+    std::size_t count() const { return mFolds; }
+
+    Fold operator[](std::size_t const index) const
+    {
+        using walk_forward_detail::rowAt;
+
+        if (index >= mFolds)
+            throw std::out_of_range("Fold index out of range");
+
+        auto const rows = mTime.size();
+        RowRange const test{index * rows / mFolds, (index + 1) * rows / mFolds};
+        auto const trainEnd = rowAt(mTime, mTime[test.begin] - mPurge);
+        auto const resume = ranges::upper_bound(mTime, mTime[test.end - 1] + mEmbargo) - mTime.begin();
+
+        return Fold{
+            RowRange{0, std::min(trainEnd, test.begin)},
+            test,
+            RowRange{std::max(static_cast<std::size_t>(resume), test.end), rows}};
+    }
+
+private:
+    std::span<std::int64_t const> mTime;
+    std::size_t mFolds;
+    std::int64_t mPurge;
+    std::int64_t mEmbargo;
+};
+
+/// \struct WindowStatistics
+///     Summary of the values in one window.  Variance is the sample variance.
+struct WindowStatistics
+{
+    std::size_t count = 0;
+    double mean = std::numeric_limits<double>::quiet_NaN();
+    double variance = std::numeric_limits<double>::quiet_NaN();
+    double min = std::numeric_limits<double>::quiet_NaN();
+    double max = std::numeric_limits<double>::quiet_NaN();
+};
+
+/// \class RollingStatistics
+///     Count, mean, variance, min and max of a window over a column, updated incrementally as the window moves
+///     forward: only rows entering or leaving the window are touched.  Moving backwards, or to a disjoint window,
+///     recomputes from scratch.
+class RollingStatistics
+{
+public:
+    explicit RollingStatistics(std::span<double const> const values)
+        : mValues(values)
+    {}
+
+    WindowStatistics const& moveTo(RowRange const window)
+    {
+        if (window.end > mValues.size() || window.begin > window.end)
+            throw std::out_of_range("Window outside of column");
+
+        if (window.begin < mWindow.begin || window.end < mWindow.end || window.begin >= mWindow.end)
+            reset(window.begin);
+        for (auto i = mWindow.end; i < window.end; ++i)
+            push(i);
+        for (auto i = mWindow.begin; i < window.begin; ++i)
+            pop(i);
+        mWindow = window;
+        summarise();
+        return mStatistics;
+    }
+
+    WindowStatistics const& statistics() const { return mStatistics; }
+
+private:
+    void reset(std::size_t const begin)
+    {
+        mWindow = RowRange{begin, begin};
+        mShift = begin < mValues.size() ? mValues[begin] : 0.0;
+        mSum = mSumSquares = 0.0;
+        mMin.clear();
+        mMax.clear();
+    }
+
+    void push(std::size_t const i)
+    {
+        auto const value = mValues[i] - mShift;
+        mSum += value;
+        mSumSquares += value * value;
+        while (!mMin.empty() && mValues[mMin.back()] >= mValues[i])
+            mMin.pop_back();
+        mMin.push_back(i);
+        while (!mMax.empty() && mValues[mMax.back()] <= mValues[i])
+            mMax.pop_back();
+        mMax.push_back(i);
+    }
+
+    void pop(std::size_t const i)
+    {
+        auto const value = mValues[i] - mShift;
+        mSum -= value;
+        mSumSquares -= value * value;
+        if (!mMin.empty() && mMin.front() == i)
+            mMin.pop_front();
+        if (!mMax.empty() && mMax.front() == i)
+            mMax.pop_front();
+    }
+
+    void summarise()
+    {
+        mStatistics = WindowStatistics{};
+        auto const count = mWindow.size();
+        mStatistics.count = count;
+        if (count == 0)
+            return;
+
+        auto const n = static_cast<double>(count);
+        mStatistics.mean = mShift + mSum / n;
+        if (count > 1)
+            mStatistics.variance = std::max(0.0, (mSumSquares - mSum * mSum / n) / (n - 1));
+        mStatistics.min = mValues[mMin.front()];
+        mStatistics.max = mValues[mMax.front()];
+    }
+
+    std::span<double const> mValues;
+    RowRange mWindow;
+    double mShift = 0.0;
+    double mSum = 0.0;
+    double mSumSquares = 0.0;
+    std::deque<std::size_t> mMin;
+    std::deque<std::size_t> mMax;
+    WindowStatistics mStatistics;
+};
+
+/// \struct FoldStatistics
+///     Statistics of one column over the train and test windows of a fold.
+struct FoldStatistics
+{
+    WindowStatistics train;
+    WindowStatistics test;
+};
+
+/// Statistics of `values` for every walk-forward fold, carried incrementally from one fold to the next.
+inline std::vector<FoldStatistics> foldStatistics(
+    WalkForwardSplitter const& splitter, std::span<double const> const values)
+{
+    RollingStatistics train(values);
+    RollingStatistics test(values);
+
+    std::vector<FoldStatistics> result;
+    result.reserve(splitter.count());
+    for (std::size_t i = 0; i < splitter.count(); ++i)
+    {
+        auto const fold = splitter[i];
+        result.push_back(FoldStatistics{train.moveTo(fold.train), test.moveTo(fold.test)});
+    }
+    return result;
+}
+
+}    // namespace profitview
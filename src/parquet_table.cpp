@@ -1,4 +1,12 @@
+#include "expression.hpp"
+#include "portfolio_metrics.hpp"
+#include "pipeline.hpp"
 #include "print.hpp"
+#include "ranges.hpp"
+#include "row_group_stream.hpp"
+#include "schema_resolution.hpp"
+#include "tick_store.hpp"
+#include "walk_forward.hpp"
 
 #include <arrow/api.h>
 #include <arrow/io/api.h>
@@ -6,16 +14,23 @@
 #include <arrow/status.h>
 #include <parquet/arrow/reader.h>
 
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <pybind11/pybind11.h>
 
 #include <boost/range/irange.hpp>
 
+#include <algorithm>
 #include <filesystem>
 #include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string_view>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -24,23 +39,138 @@ using namespace profitview::print_ns;
 using namespace arrow;
 using namespace arrow::io;
 
+namespace py = pybind11; 
+
+// Hands ownership of `values` to a NumPy array without copying
+template<typename T>
+py::array_t<T> as_numpy(std::vector<T>&& values)
+{
+    auto const size {static_cast<py::ssize_t>(values.size())};
+    auto const data {values.data()};
+    auto owner {std::make_unique<std::vector<T>>(std::move(values))};
+    py::capsule base(owner.get(), [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    owner.release();
+    return py::array_t<T>(size, data, base);
+}
+
+py::dict as_dict(PortfolioReport&& report)
+{
+    py::dict result;
+    result["time"] = as_numpy(std::move(report.time));
+    result["equity"] = as_numpy(std::move(report.equity));
+    result["drawdown"] = as_numpy(std::move(report.drawdown));
+    result["instrument_ids"] = as_numpy(std::move(report.instrumentIds));
+    result["instrument_pnl"] = as_numpy(std::move(report.instrumentPnl));
+    result["instrument_position"] = as_numpy(std::move(report.instrumentPosition));
+    result["instrument_fees"] = as_numpy(std::move(report.instrumentFees));
+    result["instrument_notional"] = as_numpy(std::move(report.instrumentNotional));
+    result["fills"] = report.fills;
+    result["total_pnl"] = report.totalPnl;
+    result["fees"] = report.fees;
+    result["traded_notional"] = report.tradedNotional;
+    result["turnover"] = report.turnover;
+    result["max_drawdown"] = report.maxDrawdown;
+    result["max_drawdown_fraction"] = report.maxDrawdownFraction;
+    result["sharpe"] = report.sharpe;
+    result["sortino"] = report.sortino;
+    return result;
+}
+
 class ParquetTable {
 public:
-    ParquetTable(std::string const& file_name) : schema_{}, table_{} 
+    ParquetTable(std::string const& file_name) : ParquetTable(std::vector{file_name}) {}
+
+    // Files may differ in schema: the target schema is resolved from all file footers before any data is read.
+    // Row groups are then streamed so that reading, decoding and conforming them overlap.
+    ParquetTable(std::vector<std::string> const& file_names) : schema_{}, table_{} 
     {
-        if (!std::filesystem::exists(file_name))
-            throw std::runtime_error("Enable to find file");
+        if (file_names.empty())
+            throw std::runtime_error("No files to load");
 
-        std::shared_ptr<ReadableFile> infile;
-        PARQUET_ASSIGN_OR_THROW(infile, ReadableFile::Open(file_name));
+        std::vector<std::shared_ptr<ReadableFile>> files;
+        std::vector<std::shared_ptr<parquet::FileMetaData>> footers;
+        std::vector<std::shared_ptr<Schema>> schemas;
+        for (auto const& file_name: file_names) {
+            files.push_back(open_file(file_name));
+            footers.push_back(parquet::ReadMetaData(files.back()));
+            schemas.push_back(arrowSchema(*footers.back()));
+        }
+        schema_ = resolveSchema(schemas);
+
+        std::vector<std::shared_ptr<Table>> tables;
+        for (auto i: boost::irange(files.size()))
+            streamRowGroups(files[i], footers[i], 
+                [this](std::shared_ptr<Table> row_group) { return conformTable(row_group, schema_); },
+                [&tables](std::shared_ptr<Table> row_group) { tables.push_back(std::move(row_group)); });
+
+        if (tables.empty()) {
+            PARQUET_ASSIGN_OR_THROW(table_, Table::MakeEmpty(schema_));
+        }
+        else {
+            PARQUET_ASSIGN_OR_THROW(table_, ConcatenateTables(tables));
+        }
+    }
 
-        std::unique_ptr<parquet::arrow::FileReader> reader;
-        PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(
-            infile, default_memory_pool(), &reader));
+    // Calls `callback` with a dict of read-only NumPy arrays (masked where there are nulls, of Python objects for 
+    // strings) for each row group of `columns` in turn, without loading the whole file.  Without `columns`, every
+    // column with a NumPy representation is read.  Reading and decoding of the next `depth` row groups continue,
+    // without the GIL, while the callback runs.
+    static void stream(std::string const& file_name, py::function const& callback, 
+        std::vector<std::string> const& columns, std::size_t depth)
+    {
+        auto const file {open_file(file_name)};
+        auto const footer {parquet::ReadMetaData(file)};
 
-        PARQUET_THROW_NOT_OK(reader->ReadTable(&table_));
+        RowGroupStreamOptions options{.columns = columns, .pipeline = {.depth = depth}};
+        if (options.columns.empty())
+            for (auto const& field: arrowSchema(*footer)->fields())
+                if (has_numpy_values(*field->type()))
+                    options.columns.push_back(field->name());
+        if (options.columns.empty())
+            throw std::runtime_error("File has no columns with a NumPy representation");
 
+        py::gil_scoped_release release;
+        streamRowGroups(file, footer, 
+            [](std::shared_ptr<Table> row_group) {
+                std::vector<std::pair<std::string, std::shared_ptr<Array>>> arrays;
+                for (auto i: boost::irange(row_group->num_columns())) {
+                    auto const& chunks {row_group->column(i)->chunks()};
+                    std::shared_ptr<Array> combined;
+                    if (chunks.size() == 1) {
+                        combined = chunks.front();
+                    }
+                    else {
+                        PARQUET_ASSIGN_OR_THROW(combined, Concatenate(chunks));
+                    }
+                    arrays.emplace_back(row_group->field(i)->name(), std::move(combined));
+                }
+                return arrays;
+            },
+            [&callback](std::vector<std::pair<std::string, std::shared_ptr<Array>>> arrays) {
+                py::gil_scoped_acquire acquire;
+                py::dict batch;
+                for (auto const& [name, values]: arrays)
+                    batch[py::str(name)] = numpy_values(values);
+                callback(batch);
+            },
+            options);
+    }
+
+    // Appends the result of `expression` (see ExpressionParser) as a new column and returns its number
+    int derive(std::string const& name, std::string const& expression)
+    {
+        if(schema_->GetFieldIndex(name) != -1)
+            throw std::runtime_error("Column '" + name + "' already exists");
+
+        auto values {evaluateExpression(table_, parseExpression(expression))};
+        PARQUET_ASSIGN_OR_THROW(table_, table_->AddColumn(table_->num_columns(), field(name, values->type()), values));
         schema_ = table_->schema();
+        return schema_->num_fields() - 1;
+    }
+
+    ParquetTable filter(std::string const& expression) const
+    {
+        return ParquetTable{filterTable(table_, parseExpression(expression))};
     }
 
     void print_stats() 
@@ -58,7 +188,8 @@ public:
         }
     }
 
-    using ParquetColumnTypes = std::variant<double, std::int64_t, std::string_view>;
+    // Nulls are returned as std::monostate, i.e. None in Python
+    using ParquetColumnTypes = std::variant<std::monostate, double, std::int64_t, std::string_view>;
 
     std::vector<ParquetColumnTypes> column(int column_number) 
     {
@@ -76,33 +207,310 @@ public:
                 { result.emplace_back(d); });
 
             for(const auto& chunk: chunks) 
-                if(chunk->Accept(&visitor) != Status::OK()) 
-                    throw std::runtime_error("Accept fail");
+                if(auto status {chunk->Accept(&visitor)}; !status.ok()) 
+                    throw std::runtime_error("Unable to read column of type " 
+                        + chunk->type()->ToString() + ": " + status.ToString());
         }
         return result; 
     }
 
+    TickStore tick_store(int time_column, int price_column, int size_column, 
+        std::optional<std::int64_t> price_scale)
+    {
+        ChunkCursor<std::int64_t> times{
+            fixed_width_chunks<std::int64_t>(time_column, {Type::INT64, Type::TIMESTAMP})};
+        ChunkCursor<double> prices{fixed_width_chunks<double>(price_column, {Type::DOUBLE})};
+        ChunkCursor<std::int64_t> sizes{fixed_width_chunks<std::int64_t>(size_column, {Type::INT64})};
+
+        TickStore store{price_scale};
+        while(auto length{std::min({times.remaining(), prices.remaining(), sizes.remaining()})})
+            store.append(times.take(length), prices.take(length), sizes.take(length));
+        store.seal();
+        return store;
+    }
+
+    // Zero-copy, read-only NumPy view of a numeric column without nulls
+    py::array array(int column_number)
+    {
+        auto values {combined_column(column_number)};
+        if(values->null_count() > 0)
+            throw std::runtime_error("Column contains nulls, use masked_array() instead");
+        return numpy_view(values);
+    }
+
+    // As array(), but nulls are masked using the column's validity bitmap
+    py::object masked_array(int column_number)
+    {
+        return masked_view(combined_column(column_number));
+    }
+
+    WalkForwardSplitter walk_forward(int time_column, WalkForwardOptions const& options)
+    {
+        return WalkForwardSplitter{contiguous<std::int64_t>(time_column, {Type::INT64, Type::TIMESTAMP}), options};
+    }
+
+    PurgedKFoldSplitter purged_kfold(int time_column, std::size_t folds, 
+        std::int64_t purge, std::int64_t embargo)
+    {
+        return PurgedKFoldSplitter{
+            contiguous<std::int64_t>(time_column, {Type::INT64, Type::TIMESTAMP}), folds, purge, embargo};
+    }
+
+    py::dict fold_statistics(WalkForwardSplitter const& splitter, int value_column)
+    {
+        auto const statistics {foldStatistics(splitter, contiguous<double>(value_column, {Type::DOUBLE}))};
+
+        py::dict result;
+        for(auto const& [name, window]: {
+                std::pair{"train", &FoldStatistics::train}, std::pair{"test", &FoldStatistics::test}}) {
+            std::vector<std::int64_t> count;
+            std::vector<double> mean, variance, min, max;
+            for(auto const& fold: statistics) {
+                auto const& s {fold.*window};
+                count.push_back(static_cast<std::int64_t>(s.count));
+                mean.push_back(s.mean);
+                variance.push_back(s.variance);
+                min.push_back(s.min);
+                max.push_back(s.max);
+            }
+            auto const prefix {std::string{name} + "_"};
+            result[py::str(prefix + "count")] = as_numpy(std::move(count));
+            result[py::str(prefix + "mean")] = as_numpy(std::move(mean));
+            result[py::str(prefix + "variance")] = as_numpy(std::move(variance));
+            result[py::str(prefix + "min")] = as_numpy(std::move(min));
+            result[py::str(prefix + "max")] = as_numpy(std::move(max));
+        }
+        return result;
+    }
+
+    // Quantity may be double or int64, instruments int64 ids or strings.  Per-instrument results follow the order in
+    // which instruments first appear; for strings, "instruments" holds their names in that order.
+    py::dict portfolio_metrics(int time_column, int instrument_column, int quantity_column, 
+        int price_column, std::optional<int> fee_column, MetricsOptions const& options)
+    {
+        auto const times {contiguous<std::int64_t>(time_column, {Type::INT64, Type::TIMESTAMP})};
+        auto const prices {contiguous<double>(price_column, {Type::DOUBLE})};
+        auto const fees {fee_column ? contiguous<double>(*fee_column, {Type::DOUBLE}) : std::span<double const>{}};
+
+        std::variant<std::span<double const>, std::span<std::int64_t const>> quantities;
+        if(combined_column(quantity_column)->type_id() == Type::INT64)
+            quantities = contiguous<std::int64_t>(quantity_column, {Type::INT64});
+        else
+            quantities = contiguous<double>(quantity_column, {Type::DOUBLE});
+
+        std::vector<std::int64_t> instrument_ids;
+        py::list instrument_names;
+        std::span<std::int64_t const> instruments;
+        if(auto values {combined_column(instrument_column)}; values->type_id() == Type::STRING) {
+            if(values->null_count() > 0)
+                throw std::runtime_error("Column contains nulls, which are not supported here");
+            auto const& symbols {static_cast<StringArray const&>(*values)};
+            std::unordered_map<std::string_view, std::int64_t> ids;
+            instrument_ids.reserve(symbols.length());
+            for(auto i: boost::irange(symbols.length())) {
+                auto [id, inserted] {ids.try_emplace(symbols.GetView(i), static_cast<std::int64_t>(ids.size()))};
+                if(inserted)
+                    instrument_names.append(py::str(std::string{id->first}));
+                instrument_ids.push_back(id->second);
+            }
+            instruments = instrument_ids;
+        }
+        else
+            instruments = contiguous<std::int64_t>(instrument_column, {Type::INT64});
+
+        auto result {std::visit([&](auto quantity) {
+            return as_dict(portfolioMetrics(times, instruments, quantity, prices, fees, options));
+        }, quantities)};
+        result["instruments"] = instrument_names;
+        return result;
+    }
+
 private:
+    explicit ParquetTable(std::shared_ptr<Table> table) : schema_{table->schema()}, table_{std::move(table)} {}
+
+    static std::shared_ptr<ReadableFile> open_file(std::string const& file_name)
+    {
+        if (!std::filesystem::exists(file_name))
+            throw std::runtime_error("Enable to find file");
+
+        std::shared_ptr<ReadableFile> infile;
+        PARQUET_ASSIGN_OR_THROW(infile, ReadableFile::Open(file_name));
+        return infile;
+    }
+
+    static bool has_numpy_values(DataType const& type)
+    {
+        switch(type.id()) {
+            case Type::DOUBLE:
+            case Type::INT64:
+            case Type::TIMESTAMP:
+            case Type::INT32:
+            case Type::STRING:
+            case Type::LARGE_STRING:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // NumPy view of a numeric column, masked where there are nulls, or an object array of str and None for strings
+    static py::object numpy_values(std::shared_ptr<Array> const& values)
+    {
+        auto const strings {[](auto const& typed) {
+            py::list result(typed.length());
+            for(auto i: boost::irange(typed.length()))
+                result[i] = typed.IsNull(i) ? py::object(py::none()) 
+                                            : py::object(py::str(std::string{typed.GetView(i)}));
+            return py::module_::import("numpy").attr("array")(result, py::arg("dtype") = "object");
+        }};
+
+        switch(values->type_id()) {
+            case Type::STRING:
+                return strings(static_cast<StringArray const&>(*values));
+            case Type::LARGE_STRING:
+                return strings(static_cast<LargeStringArray const&>(*values));
+            default:
+                return values->null_count() > 0 ? masked_view(values) : py::object(numpy_view(values));
+        }
+    }
+
+    static py::array numpy_view(std::shared_ptr<Array> const& values)
+    {
+        py::capsule base(new std::shared_ptr<Array>(values), 
+            [](void* p) { delete static_cast<std::shared_ptr<Array>*>(p); });
+        auto const length {static_cast<py::ssize_t>(values->length())};
+
+        py::array result;
+        switch(values->type_id()) {
+            case Type::DOUBLE:
+                result = py::array_t<double>(length, values->data()->GetValues<double>(1), base);
+                break;
+            case Type::INT64:
+            case Type::TIMESTAMP:
+                result = py::array_t<std::int64_t>(length, values->data()->GetValues<std::int64_t>(1), base);
+                break;
+            case Type::INT32:
+                result = py::array_t<std::int32_t>(length, values->data()->GetValues<std::int32_t>(1), base);
+                break;
+            default:
+                throw std::runtime_error("Column has type " + values->type()->ToString() + ", which has no NumPy view");
+        }
+        result.attr("setflags")(py::arg("write") = false);
+        return result;
+    }
+
+    static py::object masked_view(std::shared_ptr<Array> const& values)
+    {
+        auto data {numpy_view(values)};
+
+        py::array_t<bool> mask(values->length());
+        auto flags {mask.mutable_unchecked<1>()};
+        for(auto i: boost::irange(values->length()))
+            flags(i) = values->IsNull(i);
+
+        return py::module_::import("numpy.ma").attr("MaskedArray")(data, py::arg("mask") = mask);
+    }
+
+    // Concatenates a multi-chunk column once, in place, so it can be viewed contiguously from then on
+    std::shared_ptr<Array> combined_column(int column_number)
+    {
+        if(0 > column_number || column_number >= schema_->num_fields())
+            throw std::range_error("Column number out of range");
+
+        auto column {table_->column(column_number)};
+        if(column->num_chunks() == 1)
+            return column->chunk(0);
+
+        std::shared_ptr<Array> combined;
+        if(column->num_chunks() == 0) {
+            PARQUET_ASSIGN_OR_THROW(combined, MakeEmptyArray(column->type()));
+        }
+        else {
+            PARQUET_ASSIGN_OR_THROW(combined, Concatenate(column->chunks()));
+        }
+
+        PARQUET_ASSIGN_OR_THROW(table_, table_->SetColumn(column_number, schema_->field(column_number), 
+            std::make_shared<ChunkedArray>(combined)));
+        return combined;
+    }
+
+    template<typename T>
+    std::span<T const> contiguous(int column_number, std::initializer_list<Type::type> accepted)
+    {
+        auto values {combined_column(column_number)};
+        if(ranges::find(accepted, values->type_id()) == accepted.end())
+            throw std::runtime_error("Column has type " + values->type()->ToString() + ", which is not supported here");
+        if(values->null_count() > 0)
+            throw std::runtime_error("Column contains nulls, which are not supported here");
+        return {values->data()->GetValues<T>(1), static_cast<std::size_t>(values->length())};
+    }
+
+    template<typename T>
+    std::vector<std::span<T const>> fixed_width_chunks(int column_number, 
+        std::initializer_list<Type::type> accepted)
+    {
+        if(0 > column_number || column_number >= schema_->num_fields())
+            throw std::range_error("Column number out of range");
+
+        auto const& type {schema_->field(column_number)->type()};
+        if(ranges::find(accepted, type->id()) == accepted.end())
+            throw std::runtime_error("Column has type " + type->ToString() + ", which cannot be stored");
+
+        std::vector<std::span<T const>> result{};
+        for(const auto& chunk: table_->column(column_number)->chunks()) {
+            if(chunk->length() == 0)
+                continue;
+            if(chunk->null_count() > 0)
+                throw std::runtime_error("Column contains nulls, which cannot be stored");
+            result.emplace_back(chunk->data()->GetValues<T>(1), chunk->length());
+        }
+        return result;
+    }
+
+    // Walks a column's chunks so columns chunked differently can be consumed in lockstep
+    template<typename T>
+    struct ChunkCursor
+    {
+        std::size_t remaining() const 
+        { 
+            return chunk_ < chunks_.size() ? chunks_[chunk_].size() - offset_ : 0; 
+        }
+
+        std::span<T const> take(std::size_t length) 
+        {
+            auto result {chunks_[chunk_].subspan(offset_, length)};
+            if((offset_ += length) == chunks_[chunk_].size()) {
+                ++chunk_;
+                offset_ = 0;
+            }
+            return result;
+        }
+
+        std::vector<std::span<T const>> chunks_;
+        std::size_t chunk_{0};
+        std::size_t offset_{0};
+    };
+
     struct ColumnVisitor : public ArrayVisitor
     {
         ColumnVisitor(std::function<void(ParquetColumnTypes)> operation) 
         : operation_{operation} {}
 
-        Status Visit(const DoubleArray& array) {
-            for(const auto& element: array) operation_(*element);
-            return Status::OK();
-        }
+        Status Visit(const DoubleArray& array) { return visit_as<double>(array); }
+        Status Visit(const FloatArray& array) { return visit_as<double>(array); }
+        Status Visit(const Int64Array& array) { return visit_as<std::int64_t>(array); }
+        Status Visit(const Int32Array& array) { return visit_as<std::int64_t>(array); }
+        Status Visit(const TimestampArray& array) { return visit_as<std::int64_t>(array); }
+        Status Visit(const StringArray& array) { return visit_as<std::string_view>(array); }
+        Status Visit(const LargeStringArray& array) { return visit_as<std::string_view>(array); }
 
-        Status Visit(const Int64Array& array) {
-            for(const auto& element: array) operation_(*element);
+        template<typename T, typename ArrayType>
+        Status visit_as(const ArrayType& array) {
+            for(const auto& element: array) 
+                operation_(element ? ParquetColumnTypes{T(*element)} : ParquetColumnTypes{});
             return Status::OK();
         }
 
-        Status Visit(const StringArray& array) {
-            for(const auto& element: array) operation_(*element);
-            return Status::OK(); 
-        }
-
         std::function<void(ParquetColumnTypes)> operation_;
     };
 
@@ -110,14 +518,101 @@ private:
     std::shared_ptr<Table> table_;
 };
 
-namespace py = pybind11; 
-
 PYBIND11_MODULE(parquet_table, parquet_module) {
     parquet_module.doc() = "ParquetTable class plugin";
 
     py::class_<ParquetTable>(parquet_module, "ParquetTable")
         .def(py::init<std::string const&>())
+        .def(py::init<std::vector<std::string> const&>())
+        .def("derive", &ParquetTable::derive, py::arg("name"), py::arg("expression"))
+        .def("filter", &ParquetTable::filter, py::arg("expression"))
         .def("print_stats", &ParquetTable::print_stats)
         .def("column", &ParquetTable::column)
+        .def("tick_store", &ParquetTable::tick_store,
+            py::arg("time_column"), py::arg("price_column"), py::arg("size_column"),
+            py::arg("price_scale") = py::none())
+        .def("array", &ParquetTable::array)
+        .def("masked_array", &ParquetTable::masked_array)
+        .def_static("stream", &ParquetTable::stream, py::arg("file_name"), py::arg("callback"), 
+            py::arg("columns") = std::vector<std::string>{}, py::arg("depth") = 2)
+        .def("walk_forward", [](ParquetTable& table, int time_column, std::int64_t train, std::int64_t test,
+                std::int64_t step, std::int64_t purge, bool anchored) {
+                return table.walk_forward(time_column, {train, test, step, purge, anchored});
+            }, py::keep_alive<0, 1>(),
+            py::arg("time_column"), py::arg("train"), py::arg("test"), py::arg("step") = 0, 
+            py::arg("purge") = 0, py::arg("anchored") = false)
+        .def("purged_kfold", &ParquetTable::purged_kfold, py::keep_alive<0, 1>(),
+            py::arg("time_column"), py::arg("folds"), py::arg("purge") = 0, py::arg("embargo") = 0)
+        .def("fold_statistics", &ParquetTable::fold_statistics, 
+            py::arg("splitter"), py::arg("value_column"))
+        .def("portfolio_metrics", [](ParquetTable& table, int time_column, int instrument_column, 
+                int quantity_column, int price_column, std::optional<int> fee_column,
+                double initial_capital, std::int64_t period, double periods_per_year) {
+                return table.portfolio_metrics(time_column, instrument_column, quantity_column, price_column,
+                    fee_column, {initial_capital, period, periods_per_year});
+            },
+            py::arg("time_column"), py::arg("instrument_column"), py::arg("quantity_column"), 
+            py::arg("price_column"), py::arg("fee_column") = py::none(), py::arg("initial_capital") = 0.0,
+            py::arg("period") = 0, py::arg("periods_per_year") = 252.0)
+    ;
+
+    py::class_<PortfolioMetrics>(parquet_module, "PortfolioMetrics")
+        .def(py::init([](double initial_capital, std::int64_t period, double periods_per_year) {
+                return PortfolioMetrics{{initial_capital, period, periods_per_year}};
+            }),
+            py::arg("initial_capital") = 0.0, py::arg("period") = 0, py::arg("periods_per_year") = 252.0)
+        .def("on_fill", [](PortfolioMetrics& metrics, std::int64_t time, std::size_t instrument, 
+                double quantity, double price, double fee) {
+                metrics.onFill({time, instrument, quantity, price, fee});
+            },
+            py::arg("time"), py::arg("instrument"), py::arg("quantity"), py::arg("price"), py::arg("fee") = 0.0)
+        .def("on_mark", &PortfolioMetrics::onMark, py::arg("time"), py::arg("instrument"), py::arg("price"))
+        .def_property_readonly("equity", &PortfolioMetrics::equity)
+        .def_property_readonly("max_drawdown", &PortfolioMetrics::maxDrawdown)
+        .def("report", [](PortfolioMetrics const& metrics) { return as_dict(metrics.report()); })
+    ;
+
+    auto as_slice {[](RowRange const& range) { 
+        return py::slice(static_cast<py::ssize_t>(range.begin), static_cast<py::ssize_t>(range.end), 1); }};
+
+    py::class_<Fold>(parquet_module, "Fold")
+        .def_property_readonly("train", [as_slice](Fold const& fold) { return as_slice(fold.train); })
+        .def_property_readonly("test", [as_slice](Fold const& fold) { return as_slice(fold.test); })
+        .def_property_readonly("train_after", [as_slice](Fold const& fold) { return as_slice(fold.trainAfter); })
+    ;
+
+    py::class_<WalkForwardSplitter>(parquet_module, "WalkForwardSplitter")
+        .def("__len__", &WalkForwardSplitter::count)
+        .def("__getitem__", &WalkForwardSplitter::operator[])
+    ;
+
+    py::class_<PurgedKFoldSplitter>(parquet_module, "PurgedKFoldSplitter")
+        .def("__len__", &PurgedKFoldSplitter::count)
+        .def("__getitem__", &PurgedKFoldSplitter::operator[])
+    ;
+
+    py::class_<TickStore>(parquet_module, "TickStore")
+        .def(py::init<std::optional<std::int64_t>>(), py::arg("price_scale") = py::none())
+        .def("append", [](TickStore& store, 
+                py::array_t<std::int64_t, py::array::c_style | py::array::forcecast> times,
+                py::array_t<double, py::array::c_style | py::array::forcecast> prices,
+                py::array_t<std::int64_t, py::array::c_style | py::array::forcecast> sizes) {
+            store.append({times.data(), static_cast<std::size_t>(times.size())}, 
+                {prices.data(), static_cast<std::size_t>(prices.size())},
+                {sizes.data(), static_cast<std::size_t>(sizes.size())});
+        })
+        .def("seal", &TickStore::seal)
+        .def("__len__", &TickStore::size)
+        .def("block_count", &TickStore::blockCount)
+        .def("compressed_bytes", &TickStore::compressedBytes)
+        .def("uncompressed_bytes", &TickStore::uncompressedBytes)
+        .def("block", [](TickStore const& store, std::size_t index) {
+            TickBlock block;
+            store.decodeBlock(index, block);
+            auto const count {static_cast<py::ssize_t>(block.count())};
+            return py::make_tuple(py::array_t<std::int64_t>(count, block.times.data()), 
+                py::array_t<double>(count, block.prices.data()), 
+                py::array_t<std::int64_t>(count, block.sizes.data()));
+        })
     ;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "expression.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace profitview
+{
+
+namespace
+{
+
+namespace cp = arrow::compute;
+
+std::shared_ptr<arrow::Table> tradeTable()
+{
+    // Two chunks per column so evaluation runs over more than one batch
+    auto const chunked = [](auto builder, auto const& first, auto const& second)
+    {
+        arrow::ArrayVector chunks;
+        for (auto const* values : {&first, &second})
+        {
+            REQUIRE(builder.AppendValues(*values).ok());
+            std::shared_ptr<arrow::Array> chunk;
+            REQUIRE(builder.Finish(&chunk).ok());
+            chunks.push_back(chunk);
+        }
+        return std::make_shared<arrow::ChunkedArray>(std::move(chunks));
+    };
+
+    auto const schema = arrow::schema({arrow::field("price", arrow::float64()), arrow::field("size", arrow::int64())});
+    return arrow::Table::Make(
+        schema,
+        std::vector{
+            chunked(arrow::DoubleBuilder{}, std::vector{100.0, 101.0}, std::vector{99.0, 102.0}),
+            chunked(arrow::Int64Builder{}, std::vector<std::int64_t>{1, 2}, std::vector<std::int64_t>{3, 4})});
+}
+
+std::vector<double> doubles(arrow::ChunkedArray const& column)
+{
+    std::vector<double> result;
+    for (auto const& chunk : column.chunks())
+        for (auto const& value : static_cast<arrow::DoubleArray const&>(*chunk))
+            result.push_back(value.value_or(-1.0));
+    return result;
+}
+
+}    // namespace
+
+TEST_CASE("Ensure expressions parse with the expected precedence", "[expression.parse]")
+{
+    auto const price = cp::field_ref("price");
+    auto const size = cp::field_ref("size");
+
+    REQUIRE(parseExpression("price * size").expression.Equals(cp::call("multiply", {price, size})));
+    REQUIRE(parseExpression("price + 2 * size")
+                .expression.Equals(cp::call("add", {price, cp::call("multiply", {cp::literal(std::int64_t{2}), size})})));
+    REQUIRE(parseExpression("(price + 0.5) / -size")
+                .expression.Equals(
+                    cp::call("divide", {cp::call("add", {price, cp::literal(0.5)}), cp::call("negate", {size})})));
+    REQUIRE(parseExpression("price > 100 and not size == 1")
+                .expression.Equals(cp::call(
+                    "and_kleene",
+                    {cp::call("greater", {price, cp::literal(std::int64_t{100})}),
+                     cp::call("invert", {cp::call("equal", {size, cp::literal(std::int64_t{1})})})})));
+    REQUIRE(parseExpression("abs(price - 1e2)")
+                .expression.Equals(cp::call("abs", {cp::call("subtract", {price, cp::literal(100.0)})})));
+
+    auto const returns = parseExpression("price / lag(price) - 1 + 0 * lag(price, 1)");
+    REQUIRE(returns.lags.size() == 1);
+    REQUIRE(returns.lags[0].column == "price");
+    REQUIRE(returns.lags[0].periods == 1);
+
+    REQUIRE_THROWS_AS(parseExpression("price *"), std::invalid_argument);
+    REQUIRE_THROWS_AS(parseExpression("(price"), std::invalid_argument);
+    REQUIRE_THROWS_AS(parseExpression("price size"), std::invalid_argument);
+    REQUIRE_THROWS_AS(parseExpression("lag(price, 0)"), std::invalid_argument);
+}
+
+TEST_CASE("Ensure expressions evaluate over every chunk of a table", "[expression.evaluate]")
+{
+    auto const table = tradeTable();
+
+    WHEN("Deriving the notional")
+    {
+        auto const notional = evaluateExpression(table, parseExpression("price * size"));
+        THEN("Each row is computed and the chunking follows the table")
+        {
+            REQUIRE(notional->num_chunks() == 2);
+            REQUIRE(doubles(*notional) == std::vector{100.0, 202.0, 297.0, 408.0});
+        }
+    }
+    WHEN("Deriving returns across a chunk boundary")
+    {
+        auto const returns = evaluateExpression(table, parseExpression("price / lag(price) - 1"));
+        THEN("The first row is null and later rows use the previous price")
+        {
+            REQUIRE(returns->length() == 4);
+            REQUIRE(returns->null_count() == 1);
+            auto const values = doubles(*returns);
+            REQUIRE(values[0] == -1.0);
+            REQUIRE(values[2] == Approx(99.0 / 101.0 - 1.0));
+            REQUIRE(values[3] == Approx(102.0 / 99.0 - 1.0));
+        }
+    }
+    WHEN("Filtering rows")
+    {
+        auto const filtered = filterTable(table, parseExpression("price >= 100 and size > 1"));
+        THEN("Only matching rows remain, with the original columns")
+        {
+            REQUIRE(filtered->num_columns() == 2);
+            REQUIRE(filtered->num_rows() == 2);
+            REQUIRE(doubles(*filtered->column(0)) == std::vector{101.0, 102.0});
+        }
+    }
+    WHEN("Referring to unknown columns or filtering on a number")
+    {
+        REQUIRE_THROWS(evaluateExpression(table, parseExpression("volume * 2")));
+        REQUIRE_THROWS_AS(filterTable(table, parseExpression("price * 2")), std::invalid_argument);
+    }
+}
+
+}    // namespace profitview
@@ -0,0 +1,177 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "pipeline.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace profitview
+{
+
+TEST_CASE("Ensure the SPSC queue hands over every item in order", "[pipeline.queue]")
+{
+    GIVEN("A queue much smaller than the number of items")
+    {
+        SpscQueue<std::unique_ptr<int>> queue(3);
+        constexpr int count = 10'000;
+
+        // Catch2 assertions are not thread safe, so the producer only records its results
+        bool pushed = true;
+        std::thread producer(
+            [&]
+            {
+                for (int i = 0; i < count; ++i)
+                    pushed = queue.push(std::make_unique<int>(i)) && pushed;
+                queue.close();
+            });
+
+        std::vector<int> received;
+        while (auto item = queue.pop())
+            received.push_back(**item);
+        producer.join();
+
+        THEN("Items arrive in order and the closed queue ends the stream")
+        {
+            REQUIRE(pushed);
+            REQUIRE(received.size() == count);
+            REQUIRE(std::is_sorted(received.begin(), received.end()));
+            REQUIRE(received.back() == count - 1);
+        }
+    }
+    GIVEN("A queue closed by its consumer")
+    {
+        SpscQueue<int> queue(1);
+        REQUIRE(queue.push(1));
+        bool pushed = true;
+        std::thread producer([&] { pushed = queue.push(2); });
+        queue.close();
+        producer.join();
+
+        THEN("The blocked producer is released and pushed items still drain")
+        {
+            REQUIRE(!pushed);
+            REQUIRE(queue.pop() == 1);
+            REQUIRE(!queue.pop());
+        }
+    }
+    REQUIRE_THROWS_AS(SpscQueue<int>(0), std::invalid_argument);
+}
+
+TEST_CASE("Ensure pipeline stages run concurrently with bounded batches in flight", "[pipeline.run]")
+{
+    constexpr int batches = 200;
+
+    WHEN("Running every stage to completion")
+    {
+        std::atomic<int> alive = 0;
+        int maxAlive = 0;
+        struct Counted
+        {
+            std::atomic<int>* alive;
+            int value;
+            Counted(std::atomic<int>& a, int v) : alive(&a), value(v) { ++*alive; }
+            Counted(Counted&& other) noexcept : alive(other.alive), value(other.value) { ++*alive; }
+            ~Counted() { --*alive; }
+        };
+
+        int next = 0;
+        std::vector<std::string> consumed;
+        runPipeline(
+            [&]() -> std::optional<Counted>
+            {
+                if (next == batches)
+                    return std::nullopt;
+                return Counted{alive, next++};
+            },
+            [](Counted batch) { return batch.value * 2; },
+            [](int value) { return std::to_string(value); },
+            [&](std::string value)
+            {
+                maxAlive = std::max(maxAlive, alive.load());
+                consumed.push_back(std::move(value));
+            },
+            PipelineOptions{.depth = 2});
+
+        THEN("Batches arrive in order, transformed by each stage")
+        {
+            REQUIRE(consumed.size() == batches);
+            REQUIRE(consumed.front() == "0");
+            REQUIRE(consumed.back() == std::to_string(2 * (batches - 1)));
+        }
+        THEN("Memory is bounded by the queue depth rather than the input size")
+        {
+            // The queue, plus the few batches (and moved-from shells) the reader and decoder hold in passing
+            REQUIRE(maxAlive <= 8);
+            REQUIRE(alive == 0);
+        }
+    }
+    WHEN("A stage throws")
+    {
+        int next = 0;
+        int consumedCount = 0;
+        auto const run = [&]
+        {
+            runPipeline(
+                [&]() -> std::optional<int> { return next++; },    // endless unless the pipeline stops it
+                [](int value)
+                {
+                    if (value == 50)
+                        throw std::runtime_error("decode failed");
+                    return value;
+                },
+                [](int value) { return value; },
+                [&](int) { ++consumedCount; });
+        };
+
+        THEN("The pipeline stops and the error reaches the caller")
+        {
+            REQUIRE_THROWS_WITH(run(), "decode failed");
+            REQUIRE(consumedCount == 50);
+        }
+    }
+    WHEN("The consumer throws")
+    {
+        int next = 0;
+        auto const run = [&]
+        {
+            runPipeline(
+                [&]() -> std::optional<int> { return next++; },
+                [](int value) { return value; },
+                [](int value) { return value; },
+                [](int value)
+                {
+                    if (value == 10)
+                        throw std::runtime_error("strategy failed");
+                });
+        };
+
+        THEN("Upstream stages are released and the error reaches the caller")
+        {
+            REQUIRE_THROWS_WITH(run(), "strategy failed");
+        }
+    }
+}
+
+}    // namespace profitview
@@ -0,0 +1,131 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "portfolio_metrics.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace profitview
+{
+
+TEST_CASE("Ensure portfolio metrics follow a round trip trade", "[portfolio_metrics.incremental]")
+{
+    GIVEN("A long position that is marked up, down and then closed")
+    {
+        PortfolioMetrics metrics(MetricsOptions{.initialCapital = 1000.0, .period = 10, .periodsPerYear = 1.0});
+        metrics.onFill(Fill{0, 0, 10.0, 100.0, 1.0});
+        metrics.onMark(5, 0, 105.0);
+        metrics.onMark(12, 0, 95.0);
+
+        THEN("Equity and drawdown are tracked on every event")
+        {
+            REQUIRE(metrics.equity() == Approx(949.0));
+            REQUIRE(metrics.maxDrawdown() == Approx(100.0));
+        }
+
+        metrics.onFill(Fill{25, 0, -10.0, 98.0, 1.0});
+        auto const report = metrics.report();
+
+        THEN("The report holds one sample per period and the summary statistics")
+        {
+            REQUIRE(report.time == std::vector<std::int64_t>{0, 10, 20});
+            REQUIRE(report.equity.size() == 3);
+            REQUIRE(report.equity[0] == Approx(1049.0));
+            REQUIRE(report.equity[1] == Approx(949.0));
+            REQUIRE(report.equity[2] == Approx(978.0));
+            REQUIRE(report.drawdown[1] == Approx(-100.0));
+
+            REQUIRE(report.fills == 2);
+            REQUIRE(report.totalPnl == Approx(-22.0));
+            REQUIRE(report.fees == Approx(2.0));
+            REQUIRE(report.tradedNotional == Approx(1980.0));
+            REQUIRE(report.turnover == Approx(1.98));
+            REQUIRE(report.maxDrawdownFraction == Approx(100.0 / 1049.0));
+            REQUIRE(report.instrumentPnl.size() == 1);
+            REQUIRE(report.instrumentPnl[0] == Approx(-22.0));
+            REQUIRE(report.instrumentPosition[0] == Approx(0.0));
+
+            std::vector<double> const returns{0.049, -0.1, 0.029};
+            auto const mean = (returns[0] + returns[1] + returns[2]) / 3.0;
+            auto squares = 0.0;
+            for (auto const r : returns)
+                squares += (r - mean) * (r - mean);
+            REQUIRE(report.sharpe == Approx(mean / std::sqrt(squares / 2.0)));
+            REQUIRE(report.sortino == Approx(mean / std::sqrt(0.01 / 3.0)));
+        }
+        THEN("Taking a report leaves the running metrics untouched")
+        {
+            REQUIRE(metrics.report().equity.size() == 3);
+        }
+    }
+    GIVEN("Events out of time order")
+    {
+        PortfolioMetrics metrics;
+        metrics.onMark(10, 0, 1.0);
+        REQUIRE_THROWS_AS(metrics.onMark(9, 0, 1.0), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Ensure column metrics match incremental updates", "[portfolio_metrics.columns]")
+{
+    std::vector<std::int64_t> const time{1, 2, 3, 4, 5, 6};
+    std::vector<std::int64_t> const instrument{0, 2, 0, 2, 0, 2};
+    std::vector<std::int64_t> const quantity{5, -3, 0, 0, -5, 3};
+    std::vector<double> const price{10.0, 20.0, 11.0, 19.0, 12.0, 18.5};
+
+    auto const report = portfolioMetrics<std::int64_t, std::int64_t>(time, instrument, quantity, price, {});
+
+    PortfolioMetrics metrics;
+    for (std::size_t i = 0; i < time.size(); ++i)
+        metrics.onFill(Fill{time[i], static_cast<std::size_t>(instrument[i]), static_cast<double>(quantity[i]), price[i]});
+    auto const expected = metrics.report();
+
+    REQUIRE(report.equity.size() == time.size());
+    REQUIRE(report.equity == expected.equity);
+    REQUIRE(report.instrumentIds == std::vector<std::size_t>{0, 2});
+    REQUIRE(report.instrumentPnl.size() == 2);
+    REQUIRE(report.instrumentPnl[0] == Approx(10.0));
+    REQUIRE(report.instrumentPnl[1] == Approx(4.5));
+    REQUIRE(report.totalPnl == Approx(14.5));
+    REQUIRE(std::isnan(report.turnover));
+    REQUIRE(std::isnan(report.sharpe));    // per-event returns are not annualised
+
+    std::vector<double> const shortFee{1.0};
+    REQUIRE_THROWS_AS(
+        (portfolioMetrics<std::int64_t, std::int64_t>(time, instrument, quantity, price, shortFee)),
+        std::invalid_argument);
+}
+
+TEST_CASE("Ensure sparse instrument ids cost one entry each", "[portfolio_metrics.instruments]")
+{
+    std::vector<std::int64_t> const time{1, 2, 3, 4};
+    std::vector<std::int64_t> const instrument{1'000'000'000, 7, 1'000'000'000, 7};
+    std::vector<double> const quantity{1.0, 2.0, -1.0, -2.0};
+    std::vector<double> const price{100.0, 5.0, 103.0, 4.0};
+
+    auto const report = portfolioMetrics<std::int64_t, double>(time, instrument, quantity, price, {});
+
+    REQUIRE(report.instrumentIds == std::vector<std::size_t>{1'000'000'000, 7});
+    REQUIRE(report.instrumentPnl.size() == 2);
+    REQUIRE(report.instrumentPnl[0] == Approx(3.0));
+    REQUIRE(report.instrumentPnl[1] == Approx(-2.0));
+    REQUIRE(report.totalPnl == Approx(1.0));
+}
+
+}    // namespace profitview
@@ -0,0 +1,173 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "row_group_stream.hpp"
+
+#include <arrow/io/memory.h>
+#include <parquet/arrow/writer.h>
+
+#include <catch2/catch.hpp>
+
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace profitview
+{
+
+namespace
+{
+
+// In-memory Parquet file holding `table` in row groups of `rowGroupRows` rows
+std::shared_ptr<arrow::io::RandomAccessFile> parquetFile(arrow::Table const& table, std::int64_t const rowGroupRows)
+{
+    std::shared_ptr<arrow::io::BufferOutputStream> out;
+    PARQUET_ASSIGN_OR_THROW(out, arrow::io::BufferOutputStream::Create());
+    PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(table, arrow::default_memory_pool(), out, rowGroupRows));
+    std::shared_ptr<arrow::Buffer> contents;
+    PARQUET_ASSIGN_OR_THROW(contents, out->Finish());
+    return std::make_shared<arrow::io::BufferReader>(contents);
+}
+
+// An in-memory Parquet file of `rows` prices and sizes, `rowGroupRows` rows per row group
+std::shared_ptr<arrow::io::RandomAccessFile> tradeFile(std::int64_t const rows, std::int64_t const rowGroupRows)
+{
+    std::vector<double> prices(rows);
+    std::vector<std::int64_t> sizes(rows);
+    std::iota(prices.begin(), prices.end(), 100.0);
+    std::iota(sizes.begin(), sizes.end(), std::int64_t{1});
+
+    arrow::DoubleBuilder price;
+    arrow::Int64Builder size;
+    REQUIRE(price.AppendValues(prices).ok());
+    REQUIRE(size.AppendValues(sizes).ok());
+    std::shared_ptr<arrow::Array> priceArray, sizeArray;
+    REQUIRE(price.Finish(&priceArray).ok());
+    REQUIRE(size.Finish(&sizeArray).ok());
+
+    auto const schema = arrow::schema({arrow::field("price", arrow::float64()), arrow::field("size", arrow::int64())});
+    return parquetFile(*arrow::Table::Make(schema, std::vector{priceArray, sizeArray}), rowGroupRows);
+}
+
+}    // namespace
+
+TEST_CASE("Ensure row groups stream through the pipeline in order", "[row_group_stream]")
+{
+    auto const file = tradeFile(1000, 64);
+
+    WHEN("Streaming every column")
+    {
+        std::vector<std::int64_t> rows;
+        std::vector<double> firstPrices;
+        streamRowGroups(
+            file,
+            [](std::shared_ptr<arrow::Table> table) { return table; },
+            [&](std::shared_ptr<arrow::Table> table)
+            {
+                REQUIRE(table->num_columns() == 2);
+                rows.push_back(table->num_rows());
+                firstPrices.push_back(static_cast<arrow::DoubleArray const&>(*table->column(0)->chunk(0)).Value(0));
+            },
+            RowGroupStreamOptions{.pipeline = {.depth = 1}});
+
+        THEN("Each row group arrives once, in file order")
+        {
+            REQUIRE(rows.size() == 16);
+            REQUIRE(std::accumulate(rows.begin(), rows.end(), std::int64_t{0}) == 1000);
+            REQUIRE(firstPrices.front() == 100.0);
+            REQUIRE(firstPrices[1] == 164.0);
+            REQUIRE(firstPrices.back() == 100.0 + 15 * 64);
+        }
+    }
+    WHEN("Streaming selected columns and reducing them off the calling thread")
+    {
+        std::int64_t total = 0;
+        streamRowGroups(
+            file,
+            [](std::shared_ptr<arrow::Table> table)
+            {
+                // Runs on the pipeline's transform thread, where Catch2 assertions are not safe
+                if (table->num_columns() != 1)
+                    throw std::logic_error("Unrequested columns were decoded");
+                std::int64_t sum = 0;
+                for (auto const& chunk : table->column(0)->chunks())
+                    for (auto const size : static_cast<arrow::Int64Array const&>(*chunk))
+                        sum += *size;
+                return sum;
+            },
+            [&](std::int64_t sum) { total += sum; },
+            RowGroupStreamOptions{.columns = {"size"}, .useThreads = false});
+
+        THEN("Only the requested column is decoded")
+        {
+            REQUIRE(total == 1000 * 1001 / 2);
+        }
+    }
+    WHEN("Streaming an unknown column")
+    {
+        REQUIRE_THROWS_AS(
+            streamRowGroups(
+                file,
+                [](std::shared_ptr<arrow::Table> table) { return table; },
+                [](std::shared_ptr<arrow::Table>) {},
+                RowGroupStreamOptions{.columns = {"volume"}}),
+            std::runtime_error);
+    }
+}
+
+TEST_CASE("Ensure string columns stream with the rest of a row group", "[row_group_stream.strings]")
+{
+    arrow::DoubleBuilder price;
+    arrow::StringBuilder side;
+    for (int i = 0; i < 100; ++i)
+    {
+        REQUIRE(price.Append(100.0 + i).ok());
+        REQUIRE((i % 7 == 0 ? side.AppendNull() : side.Append(i % 2 == 0 ? "buy" : "sell")).ok());
+    }
+    std::shared_ptr<arrow::Array> prices, sides;
+    REQUIRE(price.Finish(&prices).ok());
+    REQUIRE(side.Finish(&sides).ok());
+    auto const schema = arrow::schema({arrow::field("price", arrow::float64()), arrow::field("side", arrow::utf8())});
+    auto const file = parquetFile(*arrow::Table::Make(schema, std::vector{prices, sides}), 30);
+
+    auto const metadata = parquet::ReadMetaData(file);
+    REQUIRE(arrowSchema(*metadata)->Equals(*schema));
+
+    std::vector<std::string> values;
+    std::int64_t nulls = 0;
+    streamRowGroups(
+        file,
+        metadata,
+        [](std::shared_ptr<arrow::Table> table) { return table->GetColumnByName("side"); },
+        [&](std::shared_ptr<arrow::ChunkedArray> column)
+        {
+            REQUIRE(column->type()->Equals(*arrow::utf8()));
+            nulls += column->null_count();
+            for (auto const& chunk : column->chunks())
+                for (auto const value : static_cast<arrow::StringArray const&>(*chunk))
+                    values.emplace_back(value.value_or("null"));
+        });
+
+    REQUIRE(values.size() == 100);
+    REQUIRE(nulls == 15);
+    REQUIRE(values[0] == "null");
+    REQUIRE(values[1] == "sell");
+    REQUIRE(values[96] == "buy");
+    REQUIRE(values[98] == "null");
+}
+
+}    // namespace profitview
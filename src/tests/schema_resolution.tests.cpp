@@ -0,0 +1,119 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "schema_resolution.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+#include <vector>
+
+namespace profitview
+{
+
+namespace
+{
+
+template<typename Builder, typename T>
+std::shared_ptr<arrow::Array> makeArray(std::vector<std::optional<T>> const& values)
+{
+    Builder builder;
+    for (auto const& value : values)
+        REQUIRE((value ? builder.Append(*value) : builder.AppendNull()).ok());
+    std::shared_ptr<arrow::Array> result;
+    REQUIRE(builder.Finish(&result).ok());
+    return result;
+}
+
+}    // namespace
+
+TEST_CASE("Ensure common types widen without losing range", "[schema_resolution.common_type]")
+{
+    REQUIRE(commonType(arrow::int32(), arrow::int32())->Equals(*arrow::int32()));
+    REQUIRE(commonType(arrow::int32(), arrow::int64())->Equals(*arrow::int64()));
+    REQUIRE(commonType(arrow::uint8(), arrow::int8())->Equals(*arrow::int16()));
+    REQUIRE(commonType(arrow::uint32(), arrow::int32())->Equals(*arrow::int64()));
+    REQUIRE(!commonType(arrow::uint64(), arrow::int64()));
+    REQUIRE(!commonType(arrow::int8(), arrow::uint64()));
+    REQUIRE(commonType(arrow::uint64(), arrow::uint8())->Equals(*arrow::uint64()));
+    REQUIRE(commonType(arrow::int64(), arrow::float32())->Equals(*arrow::float64()));
+    REQUIRE(commonType(arrow::null(), arrow::utf8())->Equals(*arrow::utf8()));
+    REQUIRE(commonType(arrow::utf8(), arrow::large_utf8())->Equals(*arrow::large_utf8()));
+    REQUIRE(commonType(arrow::timestamp(arrow::TimeUnit::MILLI), arrow::timestamp(arrow::TimeUnit::NANO))
+                ->Equals(*arrow::timestamp(arrow::TimeUnit::NANO)));
+    REQUIRE(!commonType(arrow::timestamp(arrow::TimeUnit::NANO, "UTC"), arrow::timestamp(arrow::TimeUnit::NANO)));
+    REQUIRE(!commonType(arrow::utf8(), arrow::float64()));
+}
+
+TEST_CASE("Ensure tables from different schema versions load together", "[schema_resolution.conform]")
+{
+    GIVEN("An old file with int32 sizes and a newer one with int64 sizes and an extra column")
+    {
+        auto const oldSchema = arrow::schema({
+            arrow::field("price", arrow::float64(), false),
+            arrow::field("size", arrow::int32(), false)});
+        auto const newSchema = arrow::schema({
+            arrow::field("price", arrow::float64(), false),
+            arrow::field("size", arrow::int64()),
+            arrow::field("side", arrow::utf8())});
+
+        auto const oldTable = arrow::Table::Make(
+            oldSchema,
+            std::vector{
+                makeArray<arrow::DoubleBuilder, double>({1.5, 2.5}),
+                makeArray<arrow::Int32Builder, std::int32_t>({10, std::nullopt})});
+
+        WHEN("Resolving the target schema")
+        {
+            auto const target = resolveSchema({oldSchema, newSchema});
+
+            THEN("Types are widened and columns missing from some files are nullable")
+            {
+                REQUIRE(target->num_fields() == 3);
+                REQUIRE(target->field(0)->name() == "price");
+                REQUIRE(!target->field(0)->nullable());
+                REQUIRE(target->field(1)->type()->Equals(*arrow::int64()));
+                REQUIRE(target->field(1)->nullable());
+                REQUIRE(target->field(2)->name() == "side");
+                REQUIRE(target->field(2)->nullable());
+            }
+            THEN("The old table is cast in bulk, keeping its nulls")
+            {
+                auto const conformed = conformTable(oldTable, target);
+                REQUIRE(conformed->schema()->Equals(*target));
+                REQUIRE(conformed->num_rows() == 2);
+
+                auto const sizes = conformed->column(1);
+                REQUIRE(sizes->type()->Equals(*arrow::int64()));
+                REQUIRE(sizes->null_count() == 1);
+                auto const& size = static_cast<arrow::Int64Array const&>(*sizes->chunk(0));
+                REQUIRE(size.Value(0) == 10);
+                REQUIRE(size.IsNull(1));
+
+                REQUIRE(conformed->column(2)->null_count() == 2);
+            }
+        }
+    }
+    GIVEN("Schemas with incompatible types for a field")
+    {
+        auto const a = arrow::schema({arrow::field("size", arrow::int64())});
+        auto const b = arrow::schema({arrow::field("size", arrow::utf8())});
+        REQUIRE_THROWS_AS(resolveSchema({a, b}), std::runtime_error);
+        REQUIRE_THROWS_AS(resolveSchema({}), std::invalid_argument);
+    }
+}
+
+}    // namespace profitview
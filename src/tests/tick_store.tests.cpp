@@ -0,0 +1,263 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "tick_store.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <bit>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace profitview
+{
+
+namespace
+{
+
+std::vector<Tick> generateTicks(std::size_t const count, double const tickSize)
+{
+    std::mt19937_64 engine(42);
+    std::uniform_int_distribution<std::int64_t> gap(0, 2'000'000);
+    std::uniform_int_distribution<int> move(-3, 3);
+    std::uniform_int_distribution<std::int64_t> quantity(1, 5'000);
+
+    std::vector<Tick> ticks;
+    std::int64_t time = 1'650'000'000'000'000'000;
+    std::int64_t level = 2'000'000;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        time += gap(engine);
+        level += move(engine);
+        ticks.push_back(Tick{time, static_cast<double>(level) * tickSize, quantity(engine)});
+    }
+    return ticks;
+}
+
+// Trades shaped like generate_market_data's: nanosecond times with exponential gaps, small moves on a 0.5 grid and
+// heavy tailed sizes
+std::vector<Tick> marketTicks(std::size_t const count, double const meanGap)
+{
+    std::mt19937_64 engine(7);
+    std::exponential_distribution<double> gap(1.0 / meanGap);
+    std::discrete_distribution<int> move{1, 8, 82, 8, 1};
+    std::lognormal_distribution<double> quantity(3.0, 1.5);
+
+    std::vector<Tick> ticks;
+    std::int64_t time = 1'640'995'200'000'000'000;
+    std::int64_t level = 80'000;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        time += 1 + static_cast<std::int64_t>(gap(engine));
+        level += move(engine) - 2;
+        ticks.push_back(Tick{time, static_cast<double>(level) * 0.5, 1 + static_cast<std::int64_t>(quantity(engine))});
+    }
+    return ticks;
+}
+
+std::vector<Tick> replayAll(TickStore const& store)
+{
+    std::vector<Tick> result;
+    store.replay([&result](Tick const& tick) { result.push_back(tick); });
+    return result;
+}
+
+void requireEqual(std::vector<Tick> const& actual, std::vector<Tick> const& expected)
+{
+    REQUIRE(actual.size() == expected.size());
+    for (std::size_t i = 0; i < actual.size(); ++i)
+    {
+        REQUIRE(actual[i].time == expected[i].time);
+        REQUIRE(actual[i].price == expected[i].price);
+        REQUIRE(actual[i].size == expected[i].size);
+    }
+}
+
+}    // namespace
+
+TEST_CASE("Ensure ticks round trip through the tick store", "[tick_store.round_trip]")
+{
+    GIVEN("Several blocks worth of ticks on a 0.5 price grid")
+    {
+        auto const ticks = generateTicks(TickStore::blockSize * 3 + 17, 0.5);
+
+        WHEN("Stored with a matching price scale")
+        {
+            TickStore store(2);
+            for (auto const& tick : ticks)
+                store.append(tick);
+
+            THEN("Replay reproduces every tick and the data is compressed")
+            {
+                REQUIRE(store.size() == ticks.size());
+                REQUIRE(store.blockCount() == 4);
+                requireEqual(replayAll(store), ticks);
+
+                store.seal();
+                requireEqual(replayAll(store), ticks);
+                REQUIRE(store.compressedBytes() * 3 < store.uncompressedBytes());
+            }
+        }
+        WHEN("Stored without a price scale")
+        {
+            TickStore store;
+            for (auto const& tick : ticks)
+                store.append(tick);
+            store.seal();
+
+            THEN("XOR encoded prices still round trip exactly")
+            {
+                requireEqual(replayAll(store), ticks);
+                REQUIRE(store.compressedBytes() < store.uncompressedBytes());
+            }
+        }
+    }
+    GIVEN("Decimal prices on a 0.01 grid and some off grid values")
+    {
+        auto ticks = generateTicks(TickStore::blockSize + 5, 0.01);
+        ticks[10].price = 1234.5678901;
+        ticks[20].price = std::numeric_limits<double>::quiet_NaN();
+        ticks[30].size = -250;
+
+        WHEN("Stored with a price scale of 100")
+        {
+            TickStore store(100);
+            for (auto const& tick : ticks)
+                store.append(tick);
+            store.seal();
+
+            THEN("The first block falls back to XOR and everything round trips bit for bit")
+            {
+                auto const replayed = replayAll(store);
+                REQUIRE(replayed.size() == ticks.size());
+                for (std::size_t i = 0; i < ticks.size(); ++i)
+                {
+                    REQUIRE(replayed[i].time == ticks[i].time);
+                    REQUIRE(std::bit_cast<std::uint64_t>(replayed[i].price) == std::bit_cast<std::uint64_t>(ticks[i].price));
+                    REQUIRE(replayed[i].size == ticks[i].size);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Ensure realistic trades compress by the documented ratios", "[tick_store.ratio]")
+{
+    GIVEN("Nanosecond trades 5ms apart on average")
+    {
+        auto const ticks = marketTicks(TickStore::blockSize * 8, 5'000'000.0);
+        TickStore store(2);
+        for (auto const& tick : ticks)
+            store.append(tick);
+        store.seal();
+
+        THEN("Timestamps dominate and the store is over 4x smaller")
+        {
+            requireEqual(replayAll(store), ticks);
+            REQUIRE(store.compressedBytes() * 4 < store.uncompressedBytes());
+        }
+    }
+    GIVEN("The same trades on a regular one second grid")
+    {
+        auto ticks = marketTicks(TickStore::blockSize * 8, 5'000'000.0);
+        for (std::size_t i = 0; i < ticks.size(); ++i)
+            ticks[i].time = 1'640'995'200'000'000'000 + static_cast<std::int64_t>(i) * 1'000'000'000;
+        TickStore store(2);
+        for (auto const& tick : ticks)
+            store.append(tick);
+        store.seal();
+
+        THEN("Evenly spaced times cost nothing and the store is over 8x smaller")
+        {
+            requireEqual(replayAll(store), ticks);
+            REQUIRE(store.compressedBytes() * 8 < store.uncompressedBytes());
+        }
+    }
+    GIVEN("Times far apart and out of order")
+    {
+        auto ticks = marketTicks(100, 5'000'000.0);
+        ticks[10].time = std::numeric_limits<std::int64_t>::min();
+        ticks[11].time = std::numeric_limits<std::int64_t>::max();
+        ticks[50].time = -1;
+        TickStore store(2);
+        for (auto const& tick : ticks)
+            store.append(tick);
+        store.seal();
+
+        THEN("Full width deltas round trip")
+        {
+            requireEqual(replayAll(store), ticks);
+        }
+    }
+}
+
+TEST_CASE("Ensure tick store columns and block access are consistent", "[tick_store.blocks]")
+{
+    auto const ticks = generateTicks(TickStore::blockSize + 1, 0.25);
+    std::vector<std::int64_t> times, sizes;
+    std::vector<double> prices;
+    for (auto const& tick : ticks)
+    {
+        times.push_back(tick.time);
+        prices.push_back(tick.price);
+        sizes.push_back(tick.size);
+    }
+
+    TickStore store(4);
+    store.append(times, prices, sizes);
+    REQUIRE(store.blockCount() == 2);
+
+    TickBlock block;
+    store.decodeBlock(1, block);
+    REQUIRE(block.count() == 1);
+    REQUIRE(block[0].time == ticks.back().time);
+
+    store.decodeBlock(0, block);
+    REQUIRE(block.count() == TickStore::blockSize);
+    REQUIRE(block.prices[100] == ticks[100].price);
+
+    REQUIRE_THROWS_AS(store.decodeBlock(2, block), std::out_of_range);
+    REQUIRE_THROWS_AS(store.append(times, prices, std::span<std::int64_t const>{}), std::invalid_argument);
+    REQUIRE_THROWS_AS(TickStore(0), std::invalid_argument);
+}
+
+TEST_CASE("Ensure appending to a large tick store takes amortised constant time", "[tick_store.append]")
+{
+    auto const ticks = generateTicks(4'000'000, 0.5);
+
+    TickStore store(2);
+    std::size_t reallocations = 0;
+    for (auto reserved = store.reservedBytes(); auto const& tick : ticks)
+    {
+        store.append(tick);
+        if (store.reservedBytes() != reserved)
+        {
+            ++reallocations;
+            reserved = store.reservedBytes();
+        }
+    }
+
+    // Full blocks must not release capacity, otherwise every block copies all the data encoded before it
+    REQUIRE(store.blockCount() == ticks.size() / TickStore::blockSize + 1);
+    REQUIRE(reallocations < 64);
+
+    store.seal();
+    REQUIRE(store.reservedBytes() < store.uncompressedBytes() / 3);
+    REQUIRE(replayAll(store).size() == ticks.size());
+}
+
+}    // namespace profitview
@@ -0,0 +1,160 @@
+/*
+Copyright 2022 Profitview
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "ranges.hpp"
+#include "walk_forward.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace profitview
+{
+
+namespace
+{
+
+// One row per time unit: row i has time 100 + i
+std::vector<std::int64_t> timeIndex(std::size_t const rows)
+{
+    std::vector<std::int64_t> time(rows);
+    std::iota(time.begin(), time.end(), 100);
+    return time;
+}
+
+WindowStatistics recompute(std::span<double const> const values, RowRange const window)
+{
+    WindowStatistics result;
+    auto const view = window.of(values);
+    result.count = view.size();
+    if (view.empty())
+        return result;
+    auto const n = static_cast<double>(view.size());
+    result.mean = std::accumulate(view.begin(), view.end(), 0.0) / n;
+    if (view.size() > 1)
+    {
+        auto const squares = std::accumulate(
+            view.begin(), view.end(), 0.0, [&result](double sum, double v) { return sum + (v - result.mean) * (v - result.mean); });
+        result.variance = squares / (n - 1);
+    }
+    result.min = *ranges::min_element(view);
+    result.max = *ranges::max_element(view);
+    return result;
+}
+
+}    // namespace
+
+TEST_CASE("Ensure walk-forward folds cover the expected rows", "[walk_forward.splitter]")
+{
+    auto const time = timeIndex(100);
+
+    GIVEN("A rolling splitter with a purge gap")
+    {
+        WalkForwardSplitter const splitter(time, WalkForwardOptions{.train = 30, .test = 10, .purge = 5});
+
+        THEN("Test windows step by the test length and training stops before the purge")
+        {
+            REQUIRE(splitter.count() == 7);
+            auto const first = splitter[0];
+            REQUIRE(first.train.begin == 0);
+            REQUIRE(first.train.end == 30);
+            REQUIRE(first.test.begin == 35);
+            REQUIRE(first.test.end == 45);
+            REQUIRE(first.trainAfter.empty());
+
+            auto const last = splitter[6];
+            REQUIRE(last.train.begin == 60);
+            REQUIRE(last.test.begin == 95);
+            REQUIRE(last.test.end == 100);
+            REQUIRE_THROWS_AS(splitter[7], std::out_of_range);
+        }
+    }
+    GIVEN("An anchored splitter")
+    {
+        WalkForwardSplitter const splitter(time, WalkForwardOptions{.train = 20, .test = 20, .step = 40, .anchored = true});
+
+        THEN("Every training window starts at the first row")
+        {
+            REQUIRE(splitter.count() == 2);
+            REQUIRE(splitter[1].train.begin == 0);
+            REQUIRE(splitter[1].train.end == 60);
+            REQUIRE(splitter[1].test.begin == 60);
+        }
+    }
+    GIVEN("Invalid options")
+    {
+        REQUIRE_THROWS_AS(WalkForwardSplitter(time, WalkForwardOptions{.train = 0, .test = 10}), std::invalid_argument);
+        std::vector<std::int64_t> const unsorted{3, 2, 1};
+        REQUIRE_THROWS_AS(WalkForwardSplitter(unsorted, WalkForwardOptions{.train = 1, .test = 1}), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Ensure purged k-fold drops rows around the test window", "[walk_forward.kfold]")
+{
+    auto const time = timeIndex(100);
+    PurgedKFoldSplitter const splitter(time, 5, 3, 7);
+
+    REQUIRE(splitter.count() == 5);
+    auto const middle = splitter[2];
+    REQUIRE(middle.test.begin == 40);
+    REQUIRE(middle.test.end == 60);
+    REQUIRE(middle.train.begin == 0);
+    REQUIRE(middle.train.end == 37);
+    REQUIRE(middle.trainAfter.begin == 67);
+    REQUIRE(middle.trainAfter.end == 100);
+
+    auto const last = splitter[4];
+    REQUIRE(last.trainAfter.empty());
+
+    REQUIRE_THROWS_AS(PurgedKFoldSplitter(time, 1), std::invalid_argument);
+}
+
+TEST_CASE("Ensure incremental fold statistics match a full recomputation", "[walk_forward.statistics]")
+{
+    auto const time = timeIndex(500);
+    std::vector<double> values(time.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+        values[i] = 1000.0 + static_cast<double>((i * 7919) % 113) - 0.5 * static_cast<double>(i % 17);
+
+    for (auto const& options : {
+             WalkForwardOptions{.train = 100, .test = 25, .purge = 2},
+             WalkForwardOptions{.train = 50, .test = 10, .step = 80},
+             WalkForwardOptions{.train = 50, .test = 30, .anchored = true}})
+    {
+        WalkForwardSplitter const splitter(time, options);
+        auto const statistics = foldStatistics(splitter, values);
+        REQUIRE(statistics.size() == splitter.count());
+
+        for (std::size_t i = 0; i < splitter.count(); ++i)
+        {
+            auto const fold = splitter[i];
+            for (auto const& [actual, window] :
+                 {std::pair{statistics[i].train, fold.train}, std::pair{statistics[i].test, fold.test}})
+            {
+                auto const expected = recompute(values, window);
+                REQUIRE(actual.count == expected.count);
+                REQUIRE(actual.mean == Approx(expected.mean));
+                REQUIRE(actual.variance == Approx(expected.variance));
+                REQUIRE(actual.min == expected.min);
+                REQUIRE(actual.max == expected.max);
+            }
+        }
+    }
+}
+
+}    // namespace profitview